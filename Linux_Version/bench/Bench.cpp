@@ -0,0 +1,278 @@
+#include <chrono>
+#include <fstream>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Cache.h"
+#include "Controller.h"
+#include "SyntheticTrace.h"
+#include "TraceParser.h"
+#include "cxxopts.hpp"
+
+/* CacheSimBench
+* measures the speed of the simulator itself, not of the simulated cache
+* + cache: ns per Cache::get (lookup of resident cells), Cache::set (fill of empty cells) and Cache::evict
+* + controller: ns per access of Controller::read/write for synthetic streams
+* + simulate: the same streams through the batched Controller::simulate
+* + parser: ns per record and bytes per second of the trace parser
+* every result is one csv row or json line
+*/
+
+typedef struct BenchResult {
+	std::string benchmark;
+	std::string variant;
+	std::string policy;
+	unsigned int associativity = 0;
+	unsigned int sets = 0;
+	unsigned long long operations = 0;
+	unsigned long long bytes = 0;		// input bytes, only for parser benchmarks
+	double seconds = 0;
+} BenchResult;
+
+class ResultPrinter {
+public:
+	ResultPrinter(std::ostream& stream, bool json) : stream(stream) {
+		this->json = json;
+		if (!json) this->stream << "benchmark,variant,policy,associativity,sets,operations,seconds,nsPerOp,bytesPerSecond\n";
+	}
+
+	void print(const BenchResult& r) {
+		double nsPerOp = r.operations ? r.seconds * 1e9 / r.operations : 0.0;
+		double bytesPerSecond = r.seconds > 0 ? r.bytes / r.seconds : 0.0;
+		if (this->json) {
+			this->stream << std::format("{{\"benchmark\":\"{}\",\"variant\":\"{}\",\"policy\":\"{}\",\"associativity\":{},\"sets\":{},\"operations\":{},\"seconds\":{:.6f},\"nsPerOp\":{:.3f},\"bytesPerSecond\":{:.0f}}}\n",
+				r.benchmark, r.variant, r.policy, r.associativity, r.sets, r.operations, r.seconds, nsPerOp, bytesPerSecond);
+		}
+		else {
+			this->stream << std::format("{},{},{},{},{},{},{:.6f},{:.3f},{:.0f}\n",
+				r.benchmark, r.variant, r.policy, r.associativity, r.sets, r.operations, r.seconds, nsPerOp, bytesPerSecond);
+		}
+		this->stream.flush();
+	}
+
+private:
+	std::ostream& stream;
+	bool json = false;
+};
+
+static volatile unsigned long long sink = 0;	// keeps results alive, so nothing is optimized away
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string policyName(EvictionPolicy policy) {
+	switch (policy) {
+	case random: return "random";
+	case fifo: return "fifo";
+	case LRU: return "LRU";
+	}
+	return "";
+}
+
+// fills every cell of the cache, the tag of a cell is its way
+static void fillCache(Cache& cache) {
+	for (unsigned int set = 0; set < cache.sets_count; set++) {
+		for (unsigned int way = 0; way < cache.associativity; way++) {
+			cache.set(way, set, 0, false, true);
+		}
+	}
+}
+
+static void benchCache(ResultPrinter& printer, EvictionPolicy policy, unsigned int associativity, unsigned int sets, unsigned long long operations) {
+	BenchResult r;
+	r.policy = policyName(policy);
+	r.associativity = associativity;
+	r.sets = sets;
+	r.benchmark = "cache";
+	FastRandom random(42);
+
+	// lookups of resident cells
+	{
+		Cache cache(sets, associativity, policy);
+		fillCache(cache);
+		std::vector<unsigned int> indices(operations), tags(operations);
+		for (unsigned long long i = 0; i < operations; i++) {
+			indices[i] = random.below(sets);
+			tags[i] = random.below(associativity);
+		}
+		unsigned long long hits = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned long long i = 0; i < operations; i++) {
+			hits += cache.get(tags[i], indices[i], 0);
+		}
+		r.seconds = secondsSince(start);
+		sink = sink + hits;
+		r.variant = "lookup";
+		r.operations = operations;
+		printer.print(r);
+	}
+
+	// fills of empty cells, the cache is rebuilt (untimed) once it is full
+	{
+		r.seconds = 0;
+		r.operations = 0;
+		while (r.operations < operations) {
+			Cache cache(sets, associativity, policy);
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			fillCache(cache);
+			r.seconds += secondsSince(start);
+			r.operations += (unsigned long long)sets * associativity;
+		}
+		r.variant = "fill";
+		printer.print(r);
+	}
+
+	// evictions from full sets
+	{
+		Cache cache(sets, associativity, policy);
+		fillCache(cache);
+		std::vector<unsigned int> indices(operations);
+		for (unsigned long long i = 0; i < operations; i++) indices[i] = random.below(sets);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned long long i = 0; i < operations; i++) {
+			Cell victim = cache.evict(associativity + i, indices[i], 0, i & 1);
+			sink = sink + victim.dirty;
+		}
+		r.seconds = secondsSince(start);
+		r.variant = "evict";
+		r.operations = operations;
+		printer.print(r);
+	}
+}
+
+static void benchController(ResultPrinter& printer, const std::vector<Access>& accesses, const std::string& stream, EvictionPolicy policy, unsigned int associativity, unsigned int sets, bool batched) {
+	const unsigned int blockSize = 64;
+	Controller controller(sets * associativity, blockSize, associativity, policy, writeBack, allocate);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (batched) {
+		controller.simulate(accesses);
+	}
+	else {
+		for (const Access& access : accesses) {
+			if (access.op == readOp) controller.read(access.address);
+			else controller.write(access.address);
+		}
+	}
+	BenchResult r;
+	r.seconds = secondsSince(start);
+	sink = sink + controller.getStats().hits;
+	r.benchmark = batched ? "simulate" : "controller";
+	r.variant = stream;
+	r.policy = policyName(policy);
+	r.associativity = associativity;
+	r.sets = sets;
+	r.operations = accesses.size();
+	printer.print(r);
+}
+
+static void benchParser(ResultPrinter& printer, const std::vector<Access>& accesses) {
+	// same layout as the traces CacheSim reads, "# <op> <address> <size>"
+	std::string text;
+	text.reserve(accesses.size() * 16);
+	for (const Access& access : accesses) {
+		text += std::format("# {} {:08x} 4\n", (int)access.op, access.address);
+	}
+
+	std::vector<Access> batch;
+	batch.reserve(accesses.size());
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	parseTrace(text.data(), text.data() + text.size(), batch, true);
+	BenchResult r;
+	r.seconds = secondsSince(start);
+	sink = sink + batch.size();
+	r.benchmark = "parser";
+	r.variant = "default";
+	r.operations = batch.size();
+	r.bytes = text.size();
+	printer.print(r);
+}
+
+int main(int argc, char* argv[]) {
+	cxxopts::Options options("CacheSimBench", "Measures the speed of the cache simulator");
+	options
+		.set_width(100)
+		.add_options()
+		("h,help", "Print help screen")
+		("b,benchmark", "Benchmarks to run [all|cache|controller|simulate|parser]", cxxopts::value<std::string>()->default_value("all"))
+		("n,operations", "Operations / accesses per measurement [uint]", cxxopts::value<unsigned long long>()->default_value("1000000"))
+		("s,sets", "Set counts to measure [uint,...]", cxxopts::value<std::vector<unsigned int>>()->default_value("64,1024,16384"))
+		("a,associativity", "Associativities to measure [uint,...]", cxxopts::value<std::vector<unsigned int>>()->default_value("1,4,16"))
+		("f,format", "Result format [csv|json]", cxxopts::value<std::string>()->default_value("csv"))
+		("o,output", "Path to output file, stdout if empty [string]", cxxopts::value<std::string>()->default_value(""));
+
+	try {
+		cxxopts::ParseResult result = options.parse(argc, argv);
+		if (result.count("help")) {
+			std::cout << options.help() << std::endl;
+			return 0;
+		}
+		std::string benchmark = result["benchmark"].as<std::string>();
+		unsigned long long operations = result["operations"].as<unsigned long long>();
+		std::vector<unsigned int> setCounts = result["sets"].as<std::vector<unsigned int>>();
+		std::vector<unsigned int> associativities = result["associativity"].as<std::vector<unsigned int>>();
+		std::string format = result["format"].as<std::string>();
+		std::string output = result["output"].as<std::string>();
+		if (format != "csv" && format != "json") {
+			throw std::invalid_argument(std::format("Argument 'format' must be [csv|json] and not '{}'", format));
+		}
+
+		std::ofstream outputFile;
+		if (output != "") {
+			outputFile.open(output);
+			if (!outputFile.is_open()) {
+				throw std::runtime_error(std::format("Couldn't open file '{}'. Check if it exists and the path to the file is correct.", output));
+			}
+		}
+		ResultPrinter printer(output == "" ? std::cout : outputFile, format == "json");
+		EvictionPolicy policies[] = { LRU, fifo, random };
+
+		if (benchmark == "all" || benchmark == "cache") {
+			for (EvictionPolicy policy : policies) {
+				for (unsigned int associativity : associativities) {
+					for (unsigned int sets : setCounts) benchCache(printer, policy, associativity, sets, operations);
+				}
+			}
+		}
+
+		bool batched = benchmark == "simulate";
+		if (benchmark == "all" || benchmark == "controller" || batched) {
+			StreamKind streams[] = { sequentialStream, stridedStream, randomStream, zipfStream, pointerChaseStream };
+			for (StreamKind kind : streams) {
+				StreamConfig config;
+				config.kind = kind;
+				config.footprint = 1 << 24;
+				config.stride = 64;
+				config.writeRatio = 0.3;
+				std::vector<Access> accesses;
+				SyntheticTrace(config).generate(accesses, operations);
+
+				for (EvictionPolicy policy : policies) {
+					for (unsigned int associativity : associativities) {
+						for (unsigned int sets : setCounts) {
+							if (!batched) benchController(printer, accesses, SyntheticTrace::kindName(kind), policy, associativity, sets, false);
+							if (batched || benchmark == "all") benchController(printer, accesses, SyntheticTrace::kindName(kind), policy, associativity, sets, true);
+						}
+					}
+				}
+			}
+		}
+
+		if (benchmark == "all" || benchmark == "parser") {
+			StreamConfig config;
+			config.kind = randomStream;
+			config.writeRatio = 0.3;
+			std::vector<Access> accesses;
+			SyntheticTrace(config).generate(accesses, operations);
+			benchParser(printer, accesses);
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << "error: " << e.what() << '\n';
+		std::cerr << "usage: see help -h/--help\n";
+		return EXIT_FAILURE;
+	}
+	return 0;
+}
@@ -0,0 +1,79 @@
+/* C interface of libcachesim, for tools that embed the simulator without C++
+* the layout of the structs only grows at the end, cachesim_get_stats takes the size the caller was built with
+* functions that can fail return 0 on success and -1 on error, cachesim_last_error() then holds the message
+*/
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CACHESIM_API_VERSION 1
+
+typedef struct cachesim cachesim;
+
+/* values match EvictionPolicy, WriteHitPolicy and WriteMissPolicy */
+enum cachesim_eviction_policy { CACHESIM_RANDOM = 0, CACHESIM_FIFO = 1, CACHESIM_LRU = 2 };
+enum cachesim_write_hit_policy { CACHESIM_WRITE_THROUGH = 0, CACHESIM_WRITE_BACK = 1 };
+enum cachesim_write_miss_policy { CACHESIM_ALLOCATE = 0, CACHESIM_NO_ALLOCATE = 1 };
+enum cachesim_op { CACHESIM_READ = 0, CACHESIM_WRITE = 1 };
+
+typedef struct cachesim_config {
+	uint32_t cell_count;		/* cells in the cache */
+	uint32_t block_size;		/* bytes per cell, power of 2 */
+	uint32_t associativity;		/* cells per set, cell_count / associativity has to be a power of 2 */
+	int32_t eviction_policy;
+	int32_t write_hit_policy;
+	int32_t write_miss_policy;
+} cachesim_config;
+
+/* same layout as the simulator's Access, a batch is passed without copying */
+typedef struct cachesim_access {
+	uint64_t address;
+	uint8_t op;					/* cachesim_op */
+	uint8_t reserved[7];
+} cachesim_access;
+
+typedef struct cachesim_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t writebacks;
+	uint64_t flush_writebacks;
+	uint64_t clean_evictions;
+	uint64_t write_throughs;
+	uint64_t fills;
+	uint64_t fill_bytes;
+	uint64_t writeback_bytes;
+	uint64_t write_through_bytes;
+} cachesim_stats;
+
+/* 1024 cells, 16 byte blocks, direct mapped, LRU, write back, write allocate (the CacheSim defaults) */
+void cachesim_config_default(cachesim_config* config);
+
+/* returns NULL if the config is invalid */
+cachesim* cachesim_create(const cachesim_config* config);
+void cachesim_destroy(cachesim* sim);
+
+/* simulates count accesses in order */
+int cachesim_simulate(cachesim* sim, const cachesim_access* accesses, size_t count);
+int cachesim_read(cachesim* sim, uint64_t address);
+int cachesim_write(cachesim* sim, uint64_t address);
+/* writes back all dirty cells, call once the trace has ended */
+int cachesim_flush(cachesim* sim);
+
+/* copies min(size, sizeof(cachesim_stats)) bytes of the counters, pass sizeof(cachesim_stats) */
+void cachesim_get_stats(const cachesim* sim, cachesim_stats* stats, size_t size);
+
+/* message of the last error on this thread, "" if there was none */
+const char* cachesim_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
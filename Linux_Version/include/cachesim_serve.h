@@ -0,0 +1,39 @@
+/* wire protocol of CacheSim serve (Unix domain socket, native byte order)
+* every message is a cachesim_message_header followed by length payload bytes
+* a connection is bound to one named cache instance with CACHESIM_OPEN, then sends the other requests for it
+* every request except CACHESIM_ACCESSES gets a reply with the same type, status 0 and the payload below,
+* or status 1 and an error message as payload (accesses only get a reply if they failed)
+*/
+#ifndef CACHESIM_SERVE_H
+#define CACHESIM_SERVE_H
+
+#include <stdint.h>
+#include "cachesim.h"
+
+#define CACHESIM_SERVE_VERSION 1
+#define CACHESIM_SERVE_WRITE (1ULL << 63)		/* set in an access for a write */
+#define CACHESIM_SERVE_MAX_PAYLOAD (64u << 20)
+
+enum cachesim_request_type {
+	CACHESIM_OPEN = 1,			/* cachesim_open_request + instance name, creates the instance or checks its config */
+	CACHESIM_ACCESSES = 2,		/* uint64 addresses, CACHESIM_SERVE_WRITE marks writes */
+	CACHESIM_STATS = 3,			/* reply: cachesim_stats */
+	CACHESIM_RESET = 4,			/* empties the cache and clears the counters */
+	CACHESIM_SNAPSHOT = 5,		/* snapshot name, keeps the instance state in the server under that name */
+	CACHESIM_RESTORE = 6,		/* snapshot name, loads a snapshot of the same configuration into the instance */
+	CACHESIM_FLUSH = 7			/* writes back all dirty cells, e.g. at the end of a trace */
+};
+
+typedef struct cachesim_message_header {
+	uint8_t type;				/* cachesim_request_type */
+	uint8_t status;				/* replies: 0 ok, 1 error */
+	uint16_t version;			/* CACHESIM_SERVE_VERSION */
+	uint32_t length;			/* payload bytes, at most CACHESIM_SERVE_MAX_PAYLOAD */
+} cachesim_message_header;
+
+typedef struct cachesim_open_request {
+	cachesim_config config;
+	/* instance name follows, up to the end of the payload */
+} cachesim_open_request;
+
+#endif
@@ -0,0 +1,138 @@
+/* producer side of the CacheSim shared memory ring (CacheSim --shm <name>)
+* header only, C99 with GCC/Clang atomics, for exactly one producer thread per ring
+*
+*   cachesim_shm_producer producer;
+*   if (cachesim_shm_attach(&producer, "/trace") != 0) ...;
+*   cachesim_shm_push(&producer, address, CACHESIM_SHM_READ);
+*   cachesim_shm_detach(&producer);
+*
+* CacheSim creates the ring and consumes it while the producer runs. A full ring blocks the producer
+* (back-pressure), or, if CacheSim was started with --shm-drop, the record is dropped and counted.
+* records are published in groups of CACHESIM_SHM_PUBLISH, cachesim_shm_flush() publishes the rest
+*/
+#ifndef CACHESIM_SHM_H
+#define CACHESIM_SHM_H
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHESIM_SHM_MAGIC 0x4d48534d49534343ULL	/* "CCSIMSHM" */
+#define CACHESIM_SHM_VERSION 1
+#define CACHESIM_SHM_DROP 1u						/* flag: drop records while the ring is full */
+#define CACHESIM_SHM_PUBLISH 64
+#define CACHESIM_SHM_READ 0
+#define CACHESIM_SHM_WRITE 1
+
+/* same layout as cachesim_access */
+typedef struct cachesim_shm_record {
+	uint64_t address;
+	uint8_t op;
+	uint8_t reserved[7];
+} cachesim_shm_record;
+
+/* three cache lines: constants, producer counters, consumer counter, the records follow */
+typedef struct cachesim_shm_ring {
+	uint64_t magic;				/* written last by the consumer, the ring is ready once it is set */
+	uint32_t version;
+	uint32_t flags;
+	uint64_t capacity;			/* records, power of 2 */
+	uint64_t reserved0[5];
+
+	uint64_t head;				/* records published by the producer */
+	uint64_t dropped;			/* records the producer dropped */
+	uint32_t producer_pid;		/* set on attach, lets the consumer notice a crashed producer */
+	uint32_t closed;			/* set on detach, after the last record */
+	uint64_t reserved1[5];
+
+	uint64_t tail;				/* records consumed */
+	uint64_t reserved2[7];
+} cachesim_shm_ring;
+
+typedef struct cachesim_shm_producer {
+	cachesim_shm_ring* ring;
+	cachesim_shm_record* records;
+	size_t mapped;
+	uint64_t mask;
+	uint64_t head;				/* next record, published up to ring->head */
+	uint64_t cached_tail;
+	uint64_t dropped;
+	int drop;
+} cachesim_shm_producer;
+
+static inline int cachesim_shm_attach(cachesim_shm_producer* producer, const char* name) {
+	char path[256];
+	struct stat status;
+	void* mapping;
+	int fd;
+	snprintf(path, sizeof(path), "%s%s", name[0] == '/' ? "" : "/", name);
+	memset(producer, 0, sizeof(*producer));
+
+	fd = shm_open(path, O_RDWR, 0);
+	if (fd < 0) return -1;
+	if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(cachesim_shm_ring)) {
+		close(fd);
+		return -1;
+	}
+	mapping = mmap(0, status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) return -1;
+
+	producer->ring = (cachesim_shm_ring*)mapping;
+	producer->mapped = status.st_size;
+	if (__atomic_load_n(&producer->ring->magic, __ATOMIC_ACQUIRE) != CACHESIM_SHM_MAGIC || producer->ring->version != CACHESIM_SHM_VERSION) {
+		munmap(mapping, producer->mapped);
+		producer->ring = 0;
+		return -1;
+	}
+	producer->records = (cachesim_shm_record*)(producer->ring + 1);
+	producer->mask = producer->ring->capacity - 1;
+	producer->head = __atomic_load_n(&producer->ring->head, __ATOMIC_RELAXED);
+	producer->cached_tail = __atomic_load_n(&producer->ring->tail, __ATOMIC_ACQUIRE);
+	producer->drop = (producer->ring->flags & CACHESIM_SHM_DROP) != 0;
+	__atomic_store_n(&producer->ring->producer_pid, (uint32_t)getpid(), __ATOMIC_RELEASE);
+	return 0;
+}
+
+static inline void cachesim_shm_flush(cachesim_shm_producer* producer) {
+	__atomic_store_n(&producer->ring->head, producer->head, __ATOMIC_RELEASE);
+}
+
+static inline void cachesim_shm_push(cachesim_shm_producer* producer, uint64_t address, int op) {
+	cachesim_shm_record* record;
+	if (producer->head - producer->cached_tail > producer->mask) {
+		/* published records are all the consumer can free, unpublished ones would wait forever */
+		cachesim_shm_flush(producer);
+		producer->cached_tail = __atomic_load_n(&producer->ring->tail, __ATOMIC_ACQUIRE);
+		while (producer->head - producer->cached_tail > producer->mask) {
+			if (producer->drop) {
+				producer->dropped++;
+				__atomic_store_n(&producer->ring->dropped, producer->dropped, __ATOMIC_RELAXED);
+				return;
+			}
+			sched_yield();
+			producer->cached_tail = __atomic_load_n(&producer->ring->tail, __ATOMIC_ACQUIRE);
+		}
+	}
+	record = &producer->records[producer->head & producer->mask];
+	record->address = address;
+	record->op = (uint8_t)op;
+	producer->head++;
+	if ((producer->head & (CACHESIM_SHM_PUBLISH - 1)) == 0) cachesim_shm_flush(producer);
+}
+
+/* publishes the last records and tells the consumer that the trace has ended */
+static inline void cachesim_shm_detach(cachesim_shm_producer* producer) {
+	if (!producer->ring) return;
+	cachesim_shm_flush(producer);
+	__atomic_store_n(&producer->ring->closed, 1u, __ATOMIC_RELEASE);
+	munmap(producer->ring, producer->mapped);
+	producer->ring = 0;
+}
+
+#endif
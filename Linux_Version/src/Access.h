@@ -0,0 +1,9 @@
+#pragma once
+
+enum AccessOp : unsigned char { readOp = 0, writeOp = 1 };
+
+// one parsed trace record
+typedef struct Access {
+	unsigned long long address;
+	AccessOp op;
+} Access;
@@ -0,0 +1,63 @@
+#include "AsyncWriter.h"
+#include <format>
+#include <stdexcept>
+
+
+AsyncWriter::AsyncWriter(const std::string& path) {
+	this->file.open(path);
+	if (!this->file.is_open()) {
+		std::string err = std::format("Couldn't open file '{}'. Check if it exists and the path to the file is correct.", path);
+		throw std::runtime_error(err);
+	}
+	this->current.reserve(bufferSize);
+	this->writer = std::thread(&AsyncWriter::writeLoop, this);
+}
+
+AsyncWriter::~AsyncWriter() {
+	this->close();
+}
+
+void AsyncWriter::write(std::string_view text) {
+	this->current.append(text);
+	if (this->current.size() >= bufferSize) this->handOver();
+}
+
+void AsyncWriter::close() {
+	if (!this->writer.joinable()) return;
+	this->handOver();
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->closing = true;
+	}
+	this->changed.notify_all();
+	this->writer.join();
+	this->file.close();
+}
+
+// moves the current buffer to the queue of the background thread
+void AsyncWriter::handOver() {
+	if (this->current.empty()) return;
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->changed.wait(lock, [this] { return this->queued.size() < maxQueuedBuffers; });
+		this->queued.push_back(std::move(this->current));
+	}
+	this->changed.notify_all();
+	this->current = std::string();
+	this->current.reserve(bufferSize);
+}
+
+void AsyncWriter::writeLoop() {
+	std::unique_lock<std::mutex> lock(this->mutex);
+	while (true) {
+		this->changed.wait(lock, [this] { return !this->queued.empty() || this->closing; });
+		if (this->queued.empty()) return;
+
+		std::string buffer = std::move(this->queued.front());
+		this->queued.pop_front();
+		lock.unlock();
+		this->changed.notify_all();
+		this->file.write(buffer.data(), buffer.size());
+		lock.lock();
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// buffered file writer, full buffers are written by a background thread
+// write() only blocks if the background thread falls behind by maxQueuedBuffers
+class AsyncWriter {
+public:
+	AsyncWriter(const std::string& path);
+	~AsyncWriter();
+	void write(std::string_view text);
+	// writes all buffered text and stops the background thread
+	void close();
+
+private:
+	static const size_t bufferSize = 1 << 16;
+	static const size_t maxQueuedBuffers = 64;
+
+	std::ofstream file;
+	std::string current;
+	std::deque<std::string> queued;
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::thread writer;
+	bool closing = false;
+
+	void handOver();
+	void writeLoop();
+};
@@ -0,0 +1,125 @@
+#pragma once
+#include <vector>
+
+// open addressing hash map from block address to Value (linear probing, backward shift erase)
+// much faster than std::unordered_map for the per access lookups of the analysis layers
+// the block address ~0 is reserved to mark empty slots
+template <typename Value>
+class BlockMap {
+public:
+	static constexpr unsigned long long emptyKey = ~0ULL;
+
+	BlockMap(unsigned long long expectedSize = 1024) {
+		unsigned long long capacity = 16;
+		while (capacity < expectedSize * 2) capacity *= 2;
+		this->keys.assign(capacity, emptyKey);
+		this->values.resize(capacity);
+		this->mask = capacity - 1;
+	}
+
+	// returns 0 if block is not in map
+	Value* find(unsigned long long block) {
+		unsigned long long slot = this->hash(block);
+		while (true) {
+			unsigned long long key = this->keys[slot];
+			if (key == block) return &this->values[slot];
+			if (key == emptyKey) return 0;
+			slot = (slot + 1) & this->mask;
+		}
+	}
+
+	// returns the value of block, a new element is value initialized
+	// inserted tells if the block was not in the map before
+	Value& insert(unsigned long long block, bool& inserted) {
+		if ((this->count + 1) * 2 > this->keys.size()) this->grow();
+		unsigned long long slot = this->hash(block);
+		while (true) {
+			unsigned long long key = this->keys[slot];
+			if (key == block) {
+				inserted = false;
+				return this->values[slot];
+			}
+			if (key == emptyKey) {
+				this->keys[slot] = block;
+				this->values[slot] = Value();
+				this->count++;
+				inserted = true;
+				return this->values[slot];
+			}
+			slot = (slot + 1) & this->mask;
+		}
+	}
+
+	// return true if block was removed
+	bool erase(unsigned long long block) {
+		unsigned long long slot = this->hash(block);
+		while (this->keys[slot] != block) {
+			if (this->keys[slot] == emptyKey) return false;
+			slot = (slot + 1) & this->mask;
+		}
+		// move following elements of the probe chain back, so no tombstones are needed
+		unsigned long long hole = slot;
+		unsigned long long next = (slot + 1) & this->mask;
+		while (this->keys[next] != emptyKey) {
+			unsigned long long home = this->hash(this->keys[next]);
+			// element may fill the hole, if its home slot is not in (hole, next]
+			if (((next - home) & this->mask) >= ((next - hole) & this->mask)) {
+				this->keys[hole] = this->keys[next];
+				this->values[hole] = this->values[next];
+				hole = next;
+			}
+			next = (next + 1) & this->mask;
+		}
+		this->keys[hole] = emptyKey;
+		this->count--;
+		return true;
+	}
+
+	// calls fn(block, value) for every element
+	template <typename Fn>
+	void forEach(Fn fn) {
+		for (unsigned long long slot = 0; slot < this->keys.size(); slot++) {
+			if (this->keys[slot] != emptyKey) fn(this->keys[slot], this->values[slot]);
+		}
+	}
+
+	void clear() {
+		this->keys.assign(this->keys.size(), emptyKey);
+		this->count = 0;
+	}
+
+	unsigned long long size() const {
+		return this->count;
+	}
+
+	unsigned long long memoryFootprint() const {
+		return this->keys.capacity() * sizeof(unsigned long long) + this->values.capacity() * sizeof(Value);
+	}
+
+private:
+	std::vector<unsigned long long> keys;
+	std::vector<Value> values;
+	unsigned long long mask = 0;
+	unsigned long long count = 0;
+
+	unsigned long long hash(unsigned long long block) const {
+		// fibonacci hashing, spreads sequential blocks over the table
+		return ((block * 0x9E3779B97F4A7C15ULL) >> 20) & this->mask;
+	}
+
+	void grow() {
+		std::vector<unsigned long long> oldKeys;
+		std::vector<Value> oldValues;
+		oldKeys.swap(this->keys);
+		oldValues.swap(this->values);
+		this->keys.assign(oldKeys.size() * 2, emptyKey);
+		this->values.resize(oldKeys.size() * 2);
+		this->mask = this->keys.size() - 1;
+		this->count = 0;
+		for (unsigned long long slot = 0; slot < oldKeys.size(); slot++) {
+			if (oldKeys[slot] == emptyKey) continue;
+			bool inserted;
+			this->insert(oldKeys[slot], inserted) = oldValues[slot];
+		}
+	}
+};
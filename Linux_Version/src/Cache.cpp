@@ -2,7 +2,9 @@
 #include "Cache.h"
 #include <string>
 #include <format>
+#include <cstring>
 #include <stdexcept>
+#include <vector>
 #include "SetFullException.h"
 
 
@@ -27,6 +29,8 @@ Cache::Cache(unsigned int sets_count, unsigned int associativity, EvictionPolicy
 		this->sets_areFull[setIdx] = false;
 	}
 
+	SET_STATS(this->sets_stats = new SetStats[sets_count]);
+
 	// if sets_count = 4 && associativity = 2
 	// sets_array = [[Cell, Cell], [Cell, Cell], [Cell, Cell], [Cell, Cell]] (2D Array of Cells, mapping cache)
 	// a inner array of form [Cell, Cell] is referred to as a set
@@ -58,22 +62,27 @@ std::string Cache::to_string() const {
 }
 // return true if exists
 // return false if does not exist
-bool Cache::get(unsigned int tag, unsigned int index, unsigned int offset) {
+bool Cache::get(unsigned long long tag, unsigned int index, unsigned int offset) {
+	return this->lookup(tag, index) != 0;
+}
+
+Cell* Cache::lookup(unsigned long long tag, unsigned int index) {
 	Cell** set = this->sets_array[index];
 
 	for (unsigned int cellIdx = 0; cellIdx < this->associativity; cellIdx++) {
 		if (set[cellIdx]->tag == tag && set[cellIdx]->valid) {
 			this->LRU_moveCellToFront(index, cellIdx);
-			return true;
+			// LRU moved the cell to the front
+			return this->evictionPolicy == LRU ? set[0] : set[cellIdx];
 		}
 	}
 
-	return false;
+	return 0;
 }
 
 // return true if exists
 // return false if does not exist
-bool Cache::set(unsigned int tag, unsigned int index, unsigned int offset, bool dirty, bool allocateOnWriteMiss) {
+bool Cache::set(unsigned long long tag, unsigned int index, unsigned int offset, bool dirty, bool allocateOnWriteMiss, bool prefetched, unsigned short validSectors) {
 	unsigned int setsIdx = index;
 	Cell** set = this->sets_array[setsIdx];
 	bool inCache = false;
@@ -84,6 +93,7 @@ bool Cache::set(unsigned int tag, unsigned int index, unsigned int offset, bool
 		Cell* cell = set[cellIdx];
 		if (cell->tag == tag && cell->valid) {
 			cell->dirty = dirty;
+			cell->dirtySectors = dirty ? cell->validSectors : 0;
 			this->LRU_moveCellToFront(setsIdx, cellIdx);
 			return true;
 		}
@@ -102,18 +112,24 @@ bool Cache::set(unsigned int tag, unsigned int index, unsigned int offset, bool
 	Cell* cell = set[cellIdx];
 	cell->dirty = dirty;
 	cell->valid = true;
+	cell->prefetched = prefetched;
+	cell->validSectors = validSectors;
+	cell->dirtySectors = dirty ? validSectors : 0;
 	cell->tag = tag;
 	this->LRU_moveCellToFront(setsIdx, cellIdx);
 
 	// keep track if set is full
 	this->sets_nextWriteIdx[setsIdx]++;
-	if (this->sets_nextWriteIdx[setsIdx] >= this->associativity) this->sets_areFull[setsIdx] = true;
+	if (this->sets_nextWriteIdx[setsIdx] >= this->associativity) {
+		this->sets_areFull[setsIdx] = true;
+		this->sets_fullCount++;
+	}
 	this->sets_nextWriteIdx[setsIdx] %= this->associativity;
 
 	return false;
 
 }
-void Cache::evict(unsigned int tag, unsigned int index, unsigned int offset, bool dirty) {
+Cell Cache::evict(unsigned long long tag, unsigned int index, unsigned int offset, bool dirty, bool prefetched, unsigned short validSectors) {
 	unsigned int setsIdx = index;
 	Cell** set = this->sets_array[setsIdx];
 	unsigned int cellIdx;
@@ -138,9 +154,133 @@ void Cache::evict(unsigned int tag, unsigned int index, unsigned int offset, boo
 	}
 	// replace data within cell
 	Cell* cell = set[cellIdx];
+	Cell victim = *cell;
 	cell->dirty = dirty;
 	cell->valid = true;
+	cell->prefetched = prefetched;
+	cell->validSectors = validSectors;
+	cell->dirtySectors = dirty ? validSectors : 0;
 	cell->tag = tag;
+	return victim;
+}
+
+unsigned int Cache::flush(unsigned long long& dirtySectors) {
+	unsigned int dirtyCells = 0;
+	for (unsigned int setIdx = 0; setIdx < this->sets_count; setIdx++) {
+		for (unsigned int cellIdx = 0; cellIdx < this->associativity; cellIdx++) {
+			Cell* cell = this->sets_array[setIdx][cellIdx];
+			if (cell->valid && cell->dirty) {
+				dirtySectors += __builtin_popcount(cell->dirtySectors);
+				cell->dirty = false;
+				cell->dirtySectors = 0;
+				dirtyCells++;
+				SET_STATS(this->sets_stats[setIdx].writebacks++);
+			}
+		}
+	}
+	return dirtyCells;
+}
+
+unsigned long long Cache::memoryFootprint() const {
+	unsigned long long bytes = this->sets_count * (sizeof(Cell**) + sizeof(unsigned int) + sizeof(bool));
+	bytes += (unsigned long long)this->sets_count * this->associativity * (sizeof(Cell*) + sizeof(Cell));
+	SET_STATS(bytes += this->sets_count * sizeof(SetStats));
+	return bytes;
+}
+
+// appends count elements and pads to 8 bytes
+static void appendArray(std::string& state, const void* data, size_t bytes) {
+	state.append((const char*)data, bytes);
+	state.append((8 - bytes % 8) % 8, '\0');
+}
+
+// copies the next array of state, checks that it is there
+static const char* takeArray(const char*& pos, const char* end, size_t bytes) {
+	size_t padded = (bytes + 7) / 8 * 8;
+	if ((size_t)(end - pos) < padded) throw std::invalid_argument("cache state is truncated");
+	const char* array = pos;
+	pos += padded;
+	return array;
+}
+
+void Cache::saveState(std::string& state) const {
+	size_t cells = (size_t)this->sets_count * this->associativity;
+	std::vector<unsigned long long> tags(cells);
+	std::vector<unsigned char> flags(cells);
+	std::vector<unsigned short> sectors(2 * cells);
+	for (unsigned int setIdx = 0; setIdx < this->sets_count; setIdx++) {
+		for (unsigned int cellIdx = 0; cellIdx < this->associativity; cellIdx++) {
+			const Cell* cell = this->sets_array[setIdx][cellIdx];
+			size_t i = (size_t)setIdx * this->associativity + cellIdx;
+			tags[i] = cell->tag;
+			flags[i] = (cell->valid ? 1 : 0) | (cell->dirty ? 2 : 0) | (cell->prefetched ? 4 : 0);
+			sectors[2 * i] = cell->validSectors;
+			sectors[2 * i + 1] = cell->dirtySectors;
+		}
+	}
+	std::vector<unsigned char> full(this->sets_areFull, this->sets_areFull + this->sets_count);
+
+	appendArray(state, tags.data(), cells * sizeof(unsigned long long));
+	appendArray(state, flags.data(), cells);
+	appendArray(state, sectors.data(), 2 * cells * sizeof(unsigned short));
+	appendArray(state, this->sets_nextWriteIdx, this->sets_count * sizeof(unsigned int));
+	appendArray(state, full.data(), this->sets_count);
+	SET_STATS(appendArray(state, this->sets_stats, this->sets_count * sizeof(SetStats)));
+}
+
+size_t Cache::loadState(const char* data, size_t size, bool withSetStats, bool withSectors) {
+	size_t cells = (size_t)this->sets_count * this->associativity;
+	const char* pos = data;
+	const char* end = data + size;
+	const char* tags = takeArray(pos, end, cells * sizeof(unsigned long long));
+	const char* flags = takeArray(pos, end, cells);
+	const char* sectors = withSectors ? takeArray(pos, end, 2 * cells * sizeof(unsigned short)) : 0;
+	const char* nextWriteIdx = takeArray(pos, end, this->sets_count * sizeof(unsigned int));
+	const char* full = takeArray(pos, end, this->sets_count);
+	// counters of a build without per set statistics are skipped, missing ones stay 0
+	const char* setStats = withSetStats ? takeArray(pos, end, this->sets_count * sizeof(SetStats)) : 0;
+
+	// set() writes to sets_array[setIdx][sets_nextWriteIdx[setIdx]], so it is checked before anything is restored:
+	// a full set has only valid cells, the other ones exactly nextWriteIdx valid cells
+	for (unsigned int setIdx = 0; setIdx < this->sets_count; setIdx++) {
+		unsigned int idx;
+		std::memcpy(&idx, nextWriteIdx + setIdx * sizeof(unsigned int), sizeof(unsigned int));
+		unsigned int validCells = 0;
+		for (unsigned int cellIdx = 0; cellIdx < this->associativity; cellIdx++) {
+			if (flags[(size_t)setIdx * this->associativity + cellIdx] & 1) validCells++;
+		}
+		bool consistent = full[setIdx] ? validCells == this->associativity : validCells == idx;
+		if (idx >= this->associativity || !consistent) {
+			std::string err = std::format("cache state of set {} is inconsistent (nextWriteIdx: {}, full: {}, valid cells: {})", setIdx, idx, full[setIdx] != 0, validCells);
+			throw std::invalid_argument(err);
+		}
+	}
+
+	this->sets_fullCount = 0;
+	for (unsigned int setIdx = 0; setIdx < this->sets_count; setIdx++) {
+		for (unsigned int cellIdx = 0; cellIdx < this->associativity; cellIdx++) {
+			Cell* cell = this->sets_array[setIdx][cellIdx];
+			size_t i = (size_t)setIdx * this->associativity + cellIdx;
+			std::memcpy(&cell->tag, tags + i * sizeof(unsigned long long), sizeof(unsigned long long));
+			cell->valid = (flags[i] & 1) != 0;
+			cell->dirty = (flags[i] & 2) != 0;
+			cell->prefetched = (flags[i] & 4) != 0;
+			if (sectors) {
+				std::memcpy(&cell->validSectors, sectors + 2 * i * sizeof(unsigned short), sizeof(unsigned short));
+				std::memcpy(&cell->dirtySectors, sectors + (2 * i + 1) * sizeof(unsigned short), sizeof(unsigned short));
+			}
+			else {
+				cell->validSectors = cell->valid ? 1 : 0;
+				cell->dirtySectors = cell->dirty ? 1 : 0;
+			}
+		}
+		this->sets_areFull[setIdx] = full[setIdx] != 0;
+		if (this->sets_areFull[setIdx]) this->sets_fullCount++;
+	}
+	std::memcpy(this->sets_nextWriteIdx, nextWriteIdx, this->sets_count * sizeof(unsigned int));
+	SET_STATS(if (setStats) std::memcpy(this->sets_stats, setStats, this->sets_count * sizeof(SetStats)));
+	(void)setStats;
+	return pos - data;
 }
 
 Cache::~Cache() {
@@ -150,6 +290,7 @@ Cache::~Cache() {
 	delete[] this->sets_array;
 	delete[] this->sets_nextWriteIdx;
 	delete[] this->sets_areFull;
+	delete[] this->sets_stats;
 }
 
 void Cache::LRU_moveCellToFront(int setIdx, int cellIdxToMove) {
@@ -3,20 +3,40 @@
 #include <iostream>
 
 typedef struct Cell {
-	unsigned int tag = 0;
+	unsigned long long tag = 0;
 	bool dirty = false;
 	bool valid = false;
+	bool prefetched = false;	// filled by the prefetcher and not used by a demand access yet
+	// sectored cells: one bit per sector, an unsectored cell only uses bit 0
+	unsigned short validSectors = 0;
+	unsigned short dirtySectors = 0;
 } Cell;
 
 enum EvictionPolicy { random, fifo, LRU };
 
+// per set counters, compiled in with CACHESIM_SET_STATS
+typedef struct SetStats {
+	unsigned long long accesses = 0;
+	unsigned long long misses = 0;
+	unsigned long long evictions = 0;
+	unsigned long long writebacks = 0;
+} SetStats;
+
+#ifdef CACHESIM_SET_STATS
+#define SET_STATS(statement) statement
+#else
+#define SET_STATS(statement)
+#endif
+
 class Cache {
 public:
 	// all elements needed to keep track of sets
 	Cell** *		sets_array = 0;			// [[Cell*, Cell*], [Cell*, Cell*]]
 	unsigned int*	sets_nextWriteIdx = 0;	// [0, 1]		   (index for fifo and to determine if set is full)
 	bool*			sets_areFull = 0;		// [false, false]  (keeps track if set is full)
+	SetStats*		sets_stats = 0;			// [{accesses, misses, evictions, writebacks}, ...] (only with CACHESIM_SET_STATS)
 	unsigned int	sets_count = 0;
+	unsigned int	sets_fullCount = 0;		// sets with sets_areFull, every fill path goes through set()
 	// other cache variables
 	unsigned int associativity = 1;
 	EvictionPolicy evictionPolicy = random;	// regulates what is replaced, if set is full: 
@@ -31,12 +51,45 @@ public:
 	std::string to_string() const;
 	// return true if exists
 	// return false if does not exist
-	bool get(unsigned int tag, unsigned int index, unsigned int offset);
+	bool get(unsigned long long tag, unsigned int index, unsigned int offset);
+	// same as get, but returns the cell (0 if it does not exist), valid until the set is changed
+	Cell* lookup(unsigned long long tag, unsigned int index);
 
 	// return true if exists
 	// return false if does not exist
-	bool set(unsigned int tag, unsigned int index, unsigned int offset, bool dirty, bool allocateOnWriteMiss);
-	void evict(unsigned int tag, unsigned int index, unsigned int offset, bool dirty);
+	// prefetched: marks an allocated cell as filled by the prefetcher
+	// validSectors: sectors loaded into an allocated cell, all of them are dirty if dirty is set
+	bool set(unsigned long long tag, unsigned int index, unsigned int offset, bool dirty, bool allocateOnWriteMiss, bool prefetched = false, unsigned short validSectors = 1);
+	// returns a copy of the replaced cell, so the caller can tell if it has to be written back
+	Cell evict(unsigned long long tag, unsigned int index, unsigned int offset, bool dirty, bool prefetched = false, unsigned short validSectors = 1);
+	// the valid cell holding tag or 0, does not count as a use (no LRU update)
+	Cell* find(unsigned long long tag, unsigned int index) const {
+		Cell** set = this->sets_array[index];
+		for (unsigned int cellIdx = 0; cellIdx < this->associativity; cellIdx++) {
+			if (set[cellIdx]->tag == tag && set[cellIdx]->valid) return set[cellIdx];
+		}
+		return 0;
+	}
+	// true if a miss in the set needs an eviction (set() would throw SetFullException)
+	bool isFull(unsigned int index) const { return this->sets_areFull[index]; }
+	// hints the cpu to load the cell pointers of a set, then (once they arrived) the cells, for batched simulation
+	void prefetchSet(unsigned int index) const { __builtin_prefetch(this->sets_array[index]); }
+	void prefetchCells(unsigned int index) const {
+		Cell** set = this->sets_array[index];
+		unsigned int cells = this->associativity < 8 ? this->associativity : 8;
+		for (unsigned int cellIdx = 0; cellIdx < cells; cellIdx++) __builtin_prefetch(set[cellIdx]);
+	}
+	// clears all dirty flags and returns how many cells were dirty (end of trace write back),
+	// dirtySectors is increased by their dirty sectors
+	unsigned int flush(unsigned long long& dirtySectors);
+	// bytes allocated for sets and cells
+	unsigned long long memoryFootprint() const;
+	// appends the cell tags, valid/dirty/prefetched flags and sector masks (in LRU order), sets_nextWriteIdx,
+	// sets_areFull and the per set counters as arrays padded to 8 bytes
+	void saveState(std::string& state) const;
+	// restores a state written by saveState for the same geometry, returns the bytes read
+	// states without sector masks (version 1) are unsectored
+	size_t loadState(const char* data, size_t size, bool withSetStats, bool withSectors);
 
 	~Cache();
 
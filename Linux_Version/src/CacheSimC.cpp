@@ -0,0 +1,111 @@
+#include "cachesim.h"
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <string>
+#include "Controller.h"
+
+// C interface of the library, exceptions must not cross it and are turned into -1 and cachesim_last_error()
+
+static_assert(sizeof(cachesim_access) == sizeof(Access), "cachesim_access has to match Access");
+static_assert(offsetof(cachesim_access, op) == offsetof(Access, op), "cachesim_access has to match Access");
+static_assert((int)CACHESIM_LRU == (int)LRU && (int)CACHESIM_FIFO == (int)fifo && (int)CACHESIM_RANDOM == (int)random, "policies have to match EvictionPolicy");
+static_assert((int)CACHESIM_WRITE_BACK == (int)writeBack && (int)CACHESIM_NO_ALLOCATE == (int)noAllocate, "policies have to match");
+
+struct cachesim {
+	Controller controller;
+};
+
+static thread_local std::string lastError;
+
+static int fail(const std::exception& e) {
+	lastError = e.what();
+	return -1;
+}
+
+void cachesim_config_default(cachesim_config* config) {
+	config->cell_count = 1024;
+	config->block_size = 16;
+	config->associativity = 1;
+	config->eviction_policy = CACHESIM_LRU;
+	config->write_hit_policy = CACHESIM_WRITE_BACK;
+	config->write_miss_policy = CACHESIM_ALLOCATE;
+}
+
+cachesim* cachesim_create(const cachesim_config* config) {
+	try {
+		if (config->eviction_policy < CACHESIM_RANDOM || config->eviction_policy > CACHESIM_LRU) throw std::invalid_argument("invalid eviction policy");
+		return new cachesim { Controller(config->cell_count, config->block_size, config->associativity, (EvictionPolicy)config->eviction_policy,
+			config->write_hit_policy == CACHESIM_WRITE_THROUGH ? writeThrough : writeBack,
+			config->write_miss_policy == CACHESIM_NO_ALLOCATE ? noAllocate : allocate) };
+	}
+	catch (const std::exception& e) {
+		fail(e);
+		return nullptr;
+	}
+}
+
+void cachesim_destroy(cachesim* sim) {
+	delete sim;
+}
+
+int cachesim_simulate(cachesim* sim, const cachesim_access* accesses, size_t count) {
+	try {
+		sim->controller.simulate(std::span<const Access>((const Access*)accesses, count));
+		return 0;
+	}
+	catch (const std::exception& e) {
+		return fail(e);
+	}
+}
+
+int cachesim_read(cachesim* sim, uint64_t address) {
+	try {
+		sim->controller.read(address);
+		return 0;
+	}
+	catch (const std::exception& e) {
+		return fail(e);
+	}
+}
+
+int cachesim_write(cachesim* sim, uint64_t address) {
+	try {
+		sim->controller.write(address);
+		return 0;
+	}
+	catch (const std::exception& e) {
+		return fail(e);
+	}
+}
+
+int cachesim_flush(cachesim* sim) {
+	try {
+		sim->controller.flush();
+		return 0;
+	}
+	catch (const std::exception& e) {
+		return fail(e);
+	}
+}
+
+void cachesim_get_stats(const cachesim* sim, cachesim_stats* stats, size_t size) {
+	const Stats& s = sim->controller.getStats();
+	cachesim_stats copy;
+	copy.hits = s.hits;
+	copy.misses = s.misses;
+	copy.evictions = s.evictions;
+	copy.writebacks = s.writebacks;
+	copy.flush_writebacks = s.flushWritebacks;
+	copy.clean_evictions = s.cleanEvictions;
+	copy.write_throughs = s.writeThroughs;
+	copy.fills = s.fills;
+	copy.fill_bytes = s.fillBytes;
+	copy.writeback_bytes = s.writebackBytes;
+	copy.write_through_bytes = s.writeThroughBytes;
+	std::memcpy(stats, &copy, size < sizeof(copy) ? size : sizeof(copy));
+}
+
+const char* cachesim_last_error(void) {
+	return lastError.c_str();
+}
@@ -4,10 +4,14 @@
 #include <format>
 #include <iostream>
 #include <string>
+#include <fstream>
 #include <cmath>
-#include "SetFullException.h"
+#include <cstring>
+#include <algorithm>
 #include "Cache.h"
 #include "Controller.h"
+#include "IntervalStats.h"
+#include "TraceInput.h"
 
 
 Controller::Controller(unsigned int cellCount, unsigned int blockSize, unsigned int associativity, EvictionPolicy evictionPolicy, WriteHitPolicy writeHitPolicy, WriteMissPolicy writeMissPolicy) {
@@ -45,75 +49,627 @@ Controller::Controller(unsigned int cellCount, unsigned int blockSize, unsigned
 	this->offsetBits = log2i(blockSize);
 	this->indexBits = log2i(setCountD);
 	this->tagBits = this->addressWidth - (this->offsetBits + this->indexBits);
+	this->sectorOffsetBits = this->offsetBits;
+	this->sectorSize = blockSize;
 	unsigned int setCount = setCountD;
 
+	this->config.cellCount = cellCount;
+	this->config.blockSize = blockSize;
+	this->config.associativity = associativity;
+	this->config.setCount = setCount;
+	this->config.evictionPolicy = evictionPolicy;
+	this->config.writeHitPolicy = writeHitPolicy;
+	this->config.writeMissPolicy = writeMissPolicy;
+
 	this->cache = new Cache(setCount, associativity, evictionPolicy);
 }
 Controller::~Controller() {
 	delete this->cache;
+	delete this->missClassifier;
+	delete this->reuseAnalyzer;
+	delete this->intervalStats;
+	delete this->pendingIntervalStats;
+	delete this->prefetcher;
+	delete this->victimCache;
+	delete this->writeBuffer;
+	delete this->latencyModel;
+	delete this->tlb;
+}
+void Controller::read(unsigned long long address) {
+	if (this->warmupRemaining) {
+		this->warmupAccess(address, false);
+		return;
+	}
+	this->readCounted(address);
+	if (this->latencyModel) this->endAccess();
+}
+
+void Controller::write(unsigned long long address) {
+	if (this->warmupRemaining) {
+		this->warmupAccess(address, true);
+		return;
+	}
+	this->writeCounted(address);
+	if (this->latencyModel) this->endAccess();
 }
-void Controller::read(unsigned int address) {
+
+void Controller::readCounted(unsigned long long address) {
 	deconstructedAddress a = this->deconstructAddress(address);
+	if (this->latencyModel) this->latencyModel->begin();
+	if (this->tlb) this->tlb->access(address);
+	bool prefetchedHit = false;
+	if (this->prefetcher) {
+		this->issuePrefetches();
+		prefetchedHit = this->usePrefetched(a);
+	}
+	if (this->reuseAnalyzer) this->reuseAnalyzer->access(address >> this->offsetBits, false);
+	if (this->intervalStats) this->intervalStats->access(address >> this->offsetBits, this->stats);
 
-	// HIT
-	bool wasAHit = this->cache->get(a.tag, a.index, a.offset);
+	// HIT (the sector has to be loaded too, the cell of a sector miss is used below)
+	unsigned short sector = this->sectorOf(a);
+	Cell* cell = this->cache->lookup(a.tag, a.index);
+	bool wasAHit = cell && (cell->validSectors & sector);
+	// the 3C classes are line misses, sector misses are counted on their own
+	if (this->missClassifier) this->classify(address, !cell, true);
+	SET_STATS(this->cache->sets_stats[a.index].accesses++);
 	if (wasAHit) {
-		this->hits++;
+		this->stats.hits++;
+		if (prefetchedHit) this->triggerPrefetcher(address >> this->offsetBits, false);
 		return;
 	}
 
 	// MISS
-	try
-	{
-		this->misses++;
-		this->cache->set(a.tag, a.index, a.offset, false, true);
+	this->stats.misses++;
+	SET_STATS(this->cache->sets_stats[a.index].misses++);
+	if (this->prefetcher) this->triggerPrefetcher(address >> this->offsetBits, true);
+	if (cell) {
+		// SECTOR MISS, only the sector is loaded
+		this->stats.sectorMisses++;
+		this->fill();
+		cell->validSectors |= sector;
+		return;
 	}
-	catch (SetFullException& e) {
+	if (this->victimCache && this->victimCacheHit(a, sector, false)) return;
+	this->fill();
+	// full sets are checked up front, a SetFullException per eviction costs more than the simulated miss
+	if (this->cache->isFull(a.index)) {
 		// EVICTION
-		this->cache->evict(a.tag, a.index, a.offset, false);
-		this->evictions++;
+		Cell victim = this->cache->evict(a.tag, a.index, a.offset, false, false, sector);
+		this->countEviction(victim, a.index);
+		return;
 	}
+	this->cache->set(a.tag, a.index, a.offset, false, true, false, sector);
 }
 
-void Controller::write(unsigned int address) {
+void Controller::writeCounted(unsigned long long address) {
 	deconstructedAddress a = this->deconstructAddress(address);
+	if (this->latencyModel) this->latencyModel->begin();
+	if (this->tlb) this->tlb->access(address);
+	bool prefetchedHit = false;
+	if (this->prefetcher) {
+		this->issuePrefetches();
+		prefetchedHit = this->usePrefetched(a);
+	}
+	if (this->reuseAnalyzer) this->reuseAnalyzer->access(address >> this->offsetBits, true);
+	if (this->intervalStats) this->intervalStats->access(address >> this->offsetBits, this->stats);
+	SET_STATS(this->cache->sets_stats[a.index].accesses++);
 
-	try
-	{
-		// HIT
-		bool wasAHit = this->cache->set(a.tag, a.index, a.offset, this->dirtyValueForWrite, this->allocateOnWriteMiss);
-		if (wasAHit) {
-			this->hits++;
-			return;
+	// HIT
+	unsigned short sector = this->sectorOf(a);
+	Cell* cell = this->cache->lookup(a.tag, a.index);
+	bool wasAHit = cell && (cell->validSectors & sector);
+	if (this->missClassifier) this->classify(address, !cell, this->allocateOnWriteMiss);
+	if (wasAHit) {
+		this->stats.hits++;
+		if (this->dirtyValueForWrite) {
+			cell->dirty = true;
+			cell->dirtySectors |= sector;
+		}
+		else {
+			this->countWriteThrough(a);
 		}
+		if (prefetchedHit) this->triggerPrefetcher(address >> this->offsetBits, false);
+		return;
+	}
 
-		// MISS
-		this->misses++;
+	// MISS
+	this->stats.misses++;
+	SET_STATS(this->cache->sets_stats[a.index].misses++);
+	if (this->prefetcher) this->triggerPrefetcher(address >> this->offsetBits, true);
+	if (cell) {
+		// SECTOR MISS
+		this->stats.sectorMisses++;
+		if (this->allocateOnWriteMiss) {
+			this->fill();
+			cell->validSectors |= sector;
+		}
+		if (this->allocateOnWriteMiss && this->dirtyValueForWrite) {
+			cell->dirty = true;
+			cell->dirtySectors |= sector;
+		}
+		else {
+			this->countWriteThrough(a);
+		}
+		return;
 	}
-	catch (SetFullException& e) {
+	if (this->victimCache && this->victimCacheHit(a, sector, true)) return;
+	// store goes to memory, if the cell is not allocated or not written back later
+	if (!this->allocateOnWriteMiss || !this->dirtyValueForWrite) this->countWriteThrough(a);
+	if (!this->allocateOnWriteMiss) return;
+	this->fill();
+	if (this->cache->isFull(a.index)) {
 		// EVICTION
-		this->cache->evict(a.tag, a.index, a.offset, this->dirtyValueForWrite);
-		this->evictions++;
-		this->misses++;
+		Cell victim = this->cache->evict(a.tag, a.index, a.offset, this->dirtyValueForWrite, false, sector);
+		this->countEviction(victim, a.index);
+		return;
+	}
+	this->cache->set(a.tag, a.index, a.offset, this->dirtyValueForWrite, true, false, sector);
+}
+
+void Controller::simulate(std::span<const Access> accesses) {
+	// the cell pointers of a set are prefetched twice as far ahead as its cells, which need the pointers
+	const size_t prefetchDistance = 8;
+	unsigned long long indexMask = (1ULL << this->indexBits) - 1;
+	size_t count = accesses.size();
+	for (size_t i = 0; i < count; i++) {
+		if (i + 2 * prefetchDistance < count) {
+			this->cache->prefetchSet((accesses[i + 2 * prefetchDistance].address >> this->offsetBits) & indexMask);
+		}
+		if (i + prefetchDistance < count) {
+			this->cache->prefetchCells((accesses[i + prefetchDistance].address >> this->offsetBits) & indexMask);
+		}
 
+		const Access& access = accesses[i];
+		if (access.op == readOp) {
+			this->read(access.address);
+		}
+		else {
+			this->write(access.address);
+		}
 	}
 }
-std::string Controller::printResults() {
-	return std::format("Results:\n  misses: {}\n  hits: {}\n  evictions: {}", this->misses, this->hits, this->evictions);
+
+void Controller::flush() {
+	// a trace that ended during the warmup has no counted accesses
+	if (this->warmupRemaining) this->finishWarmup();
+	unsigned long long dirtySectors = 0;
+	unsigned int dirtyCells = this->cache->flush(dirtySectors);
+	if (this->victimCache) {
+		for (unsigned int slot = 0; slot < this->victimCache->getEntries(); slot++) {
+			unsigned short dirty = this->victimCache->getDirtySectors(slot);
+			if (!dirty) continue;
+			this->victimCache->clean(slot);
+			dirtyCells++;
+			dirtySectors += __builtin_popcount(dirty);
+			SET_STATS(this->cache->sets_stats[this->victimCache->getBlock(slot) & ((1ULL << this->indexBits) - 1)].writebacks++);
+		}
+	}
+	if (this->writeBuffer) this->stats.bufferDrains += this->writeBuffer->drainAll(this->stats.writeThroughBytes);
+	this->stats.writebacks += dirtyCells;
+	this->stats.flushWritebacks += dirtyCells;
+	this->stats.writebackBytes += dirtySectors * this->sectorSize;
+	if (this->intervalStats) this->intervalStats->finish(this->stats);
 }
 
-deconstructedAddress Controller::deconstructAddress(unsigned int address) {
-	if (address >= pow(2, this->addressWidth)) {
-		std::string err = std::format("address({}) bigger than({})", address, pow(2, this->addressWidth));
+void Controller::setSectors(unsigned int sectors) {
+	if (!isOfBase2(sectors) || sectors > 16 || sectors > this->config.blockSize) {
+		std::string err = std::format("sectors({}) is not of base 2, at most 16 and at most blockSize({})", sectors, this->config.blockSize);
 		throw std::logic_error(err);
 	}
-	unsigned int indexMask = pow(2, this->indexBits) - 1;
-	unsigned int offsetMask = pow(2, this->offsetBits) - 1;
-	unsigned int tagMask = pow(2, this->tagBits) - 1;
+	this->config.sectors = sectors;
+	this->sectorSize = this->config.blockSize / sectors;
+	this->sectorOffsetBits = log2i(this->sectorSize);
+	this->allSectors = (unsigned short)((1U << sectors) - 1);
+}
+
+void Controller::setWarmup(unsigned long long accesses, bool untilFull, bool fastForward) {
+	this->warmupRemaining = accesses > 0 ? accesses : (untilFull ? ~0ULL : 0);
+	this->warmupUntilFull = untilFull;
+	this->fastForward = fastForward;
+	if (untilFull && this->cache->sets_fullCount == this->config.setCount) this->warmupRemaining = 0;
+	if (this->warmupRemaining && this->intervalStats) {
+		this->pendingIntervalStats = this->intervalStats;
+		this->intervalStats = 0;
+	}
+}
+
+bool Controller::isWarmingUp() const {
+	return this->warmupRemaining > 0;
+}
+
+void Controller::warmupAccess(unsigned long long address, bool isWrite) {
+	if (this->fastForward) {
+		// no timing, the memory bus does not see the warmup traffic
+		LatencyModel* latencyModel = this->latencyModel;
+		this->latencyModel = 0;
+		this->warm(address, isWrite);
+		this->latencyModel = latencyModel;
+	}
+	else if (isWrite) {
+		this->writeCounted(address);
+	}
+	else {
+		this->readCounted(address);
+	}
+	if (!this->fastForward && this->latencyModel) this->endAccess();
+
+	// counted by the cache, prefetches and victim cache swaps fill sets besides the accessed one
+	this->warmupRemaining--;
+	if (this->warmupUntilFull && this->cache->sets_fullCount == this->config.setCount) this->warmupRemaining = 0;
+	if (this->warmupRemaining == 0) this->finishWarmup();
+}
+
+// fast forward: the cache, victim cache, prefetcher and TLB updates of readCounted/writeCounted,
+// no analyzers, the counters the shared helpers touch are cleared when the warmup ends
+void Controller::warm(unsigned long long address, bool isWrite) {
+	deconstructedAddress a = this->deconstructAddress(address);
+	if (this->tlb) this->tlb->access(address);
+	bool prefetchedHit = false;
+	if (this->prefetcher) {
+		this->issuePrefetches();
+		prefetchedHit = this->usePrefetched(a);
+	}
+	unsigned short sector = this->sectorOf(a);
+	Cell* cell = this->cache->lookup(a.tag, a.index);
+	bool allocate = !isWrite || this->allocateOnWriteMiss;
+	bool dirty = isWrite && this->dirtyValueForWrite;
+	if (cell) {
+		bool sectorMiss = !(cell->validSectors & sector);
+		if (this->prefetcher && (sectorMiss || prefetchedHit)) this->triggerPrefetcher(address >> this->offsetBits, sectorMiss);
+		if (sectorMiss) {
+			if (!allocate) return;
+			cell->validSectors |= sector;
+		}
+		if (dirty) {
+			cell->dirty = true;
+			cell->dirtySectors |= sector;
+		}
+		return;
+	}
+	if (this->prefetcher) this->triggerPrefetcher(address >> this->offsetBits, true);
+	if (this->victimCache && this->victimCacheHit(a, sector, isWrite)) return;
+	if (!allocate) return;
+	if (this->cache->isFull(a.index)) {
+		// the victim moves to the victim cache
+		Cell victim = this->cache->evict(a.tag, a.index, a.offset, dirty, false, sector);
+		if (this->victimCache) this->countEviction(victim, a.index);
+		return;
+	}
+	this->cache->set(a.tag, a.index, a.offset, dirty, true, false, sector);
+}
+
+// counting starts, the state the analyzers built during the warmup is kept
+void Controller::finishWarmup() {
+	this->warmupRemaining = 0;
+	this->stats = Stats();
+	SET_STATS(std::fill(this->cache->sets_stats, this->cache->sets_stats + this->cache->sets_count, SetStats()));
+	if (this->missClassifier) this->missClassifier->clearCounters();
+	if (this->reuseAnalyzer) this->reuseAnalyzer->clearCounters();
+	if (this->latencyModel) this->latencyModel->clearCounters();
+	if (this->tlb) this->tlb->clearCounters();
+	if (this->pendingIntervalStats) {
+		this->intervalStats = this->pendingIntervalStats;
+		this->pendingIntervalStats = 0;
+	}
+}
+
+void Controller::reset() {
+	delete this->cache;
+	this->cache = new Cache(this->config.setCount, this->config.associativity, this->config.evictionPolicy);
+	if (this->intervalStats) this->intervalStats->resetCounters(this->stats);
+	this->stats = Stats();
+	// a warmup in progress is cancelled, interval statistics continue right away
+	this->warmupRemaining = 0;
+	this->warmupUntilFull = false;
+	this->fastForward = false;
+	if (this->pendingIntervalStats) {
+		this->intervalStats = this->pendingIntervalStats;
+		this->pendingIntervalStats = 0;
+	}
+	this->pendingPrefetches.clear();
+	this->accessClock = 0;
+	if (this->prefetcher) {
+		delete this->prefetcher;
+		this->prefetcher = Prefetcher::make(this->config.prefetcher, this->config.prefetchDegree);
+	}
+	if (this->victimCache) {
+		delete this->victimCache;
+		this->victimCache = new VictimCache(this->config.victimCacheEntries);
+	}
+	if (this->tlb) {
+		Tlb* tlb = new Tlb(this->tlb->getConfig());
+		delete this->tlb;
+		this->tlb = tlb;
+	}
+	if (this->latencyModel) {
+		delete this->latencyModel;
+		this->latencyModel = new LatencyModel(this->config.hitLatency, this->config.memoryLatency, this->config.bandwidth);
+	}
+	if (this->writeBuffer) {
+		delete this->writeBuffer;
+		this->writeBuffer = new WriteBuffer(this->config.writeBufferEntries, this->blockSize, this->storeSize);
+	}
+	if (this->missClassifier) {
+		delete this->missClassifier;
+		this->missClassifier = new MissClassifier(this->config.setCount * this->config.associativity);
+	}
+	if (this->reuseAnalyzer) {
+		bool withDistance = this->reuseAnalyzer->hasDistance();
+		delete this->reuseAnalyzer;
+		this->reuseAnalyzer = new ReuseAnalyzer(withDistance);
+	}
+}
+
+// start of a state, the counters and the cache arrays follow (all 8 byte aligned)
+typedef struct StateHeader {
+	char magic[4] = { 'C', 'S', 'S', 'T' };
+	unsigned int version = 2;
+	unsigned int cellCount = 0;
+	unsigned int blockSize = 0;
+	unsigned int associativity = 0;
+	unsigned int setCount = 0;
+	unsigned int evictionPolicy = 0;
+	unsigned int writeHitPolicy = 0;
+	unsigned int writeMissPolicy = 0;
+	unsigned int setStats = 0;		// 1 if the per set counters follow the cells
+	unsigned int counterCount = 0;	// uint64 counters of Stats, newer versions only append counters
+	unsigned int sectors = 1;		// version 2, the sector masks follow the cell flags
+} StateHeader;
+static_assert(sizeof(StateHeader) == 48, "the counters start 8 byte aligned");
+static_assert(sizeof(Stats) % sizeof(unsigned long long) == 0, "Stats only holds uint64 counters");
+
+void Controller::checkStateSaveable() const {
+	// their contents are not part of the state, a restored run would start from a different machine
+	const char* component = this->victimCache ? "victim cache" : this->prefetcher ? "prefetcher" : this->writeBuffer ? "write buffer" : this->tlb ? "TLB" : 0;
+	if (component) {
+		std::string err = std::format("the cache state can not be saved with a {}, its contents are not part of the state", component);
+		throw std::logic_error(err);
+	}
+}
+
+void Controller::saveState(std::string& state) const {
+	this->checkStateSaveable();
+	StateHeader header;
+	header.cellCount = this->config.cellCount;
+	header.blockSize = this->config.blockSize;
+	header.associativity = this->config.associativity;
+	header.setCount = this->config.setCount;
+	header.evictionPolicy = this->config.evictionPolicy;
+	header.writeHitPolicy = this->config.writeHitPolicy;
+	header.writeMissPolicy = this->config.writeMissPolicy;
+	header.sectors = this->config.sectors;
+	SET_STATS(header.setStats = 1);
+	header.counterCount = sizeof(Stats) / sizeof(unsigned long long);
+	state.append((const char*)&header, sizeof(header));
+	state.append((const char*)&this->stats, sizeof(Stats));
+	this->cache->saveState(state);
+}
+
+void Controller::loadState(const char* data, size_t size) {
+	StateHeader header;
+	if (size < sizeof(header) || std::memcmp(data, header.magic, 4) != 0) throw std::invalid_argument("not a cache state");
+	std::memcpy(&header, data, sizeof(header));
+	if (header.version != 1 && header.version != 2) {
+		std::string err = std::format("cache state version({}) is not supported", header.version);
+		throw std::invalid_argument(err);
+	}
+	const Config& c = this->config;
+	if (header.version == 1) header.sectors = 1;
+	if (header.sectors != c.sectors) {
+		std::string err = std::format("cache state of sectors({}) does not match the configuration", header.sectors);
+		throw std::invalid_argument(err);
+	}
+	if (header.cellCount != c.cellCount || header.blockSize != c.blockSize || header.associativity != c.associativity || header.setCount != c.setCount
+		|| header.evictionPolicy != (unsigned int)c.evictionPolicy || header.writeHitPolicy != (unsigned int)c.writeHitPolicy || header.writeMissPolicy != (unsigned int)c.writeMissPolicy) {
+		std::string err = std::format("cache state of cellCount({}) blockSize({}) associativity({}) does not match the configuration", header.cellCount, header.blockSize, header.associativity);
+		throw std::invalid_argument(err);
+	}
+	size_t countersSize = (size_t)header.counterCount * sizeof(unsigned long long);
+	if (size - sizeof(header) < countersSize) throw std::invalid_argument("cache state is truncated");
+
+	// the cache checks the size before it changes anything
+	size_t pos = sizeof(header) + countersSize;
+	this->cache->loadState(data + pos, size - pos, header.setStats != 0, header.version >= 2);
+	this->stats = Stats();
+	std::memcpy(&this->stats, data + sizeof(header), std::min(countersSize, sizeof(Stats)));
+}
+
+void Controller::writeState(const std::string& path) const {
+	std::string state;
+	this->saveState(state);
+	std::string temporary = path + ".tmp";
+	std::ofstream file(temporary, std::ios::binary);
+	if (!file.is_open()) {
+		std::string err = std::format("Couldn't open file '{}'. Check if it exists and the path to the file is correct.", temporary);
+		throw std::runtime_error(err);
+	}
+	file.write(state.data(), state.size());
+	file.close();
+	if (!file || std::rename(temporary.c_str(), path.c_str()) != 0) {
+		std::string err = std::format("Couldn't write cache state '{}'", path);
+		throw std::runtime_error(err);
+	}
+}
+
+void Controller::readState(const std::string& path) {
+	MappedFile file(path);
+	this->loadState(file.data(), file.size());
+}
+
+void Controller::enableMissClassification() {
+	if (this->missClassifier) return;
+	this->missClassifier = new MissClassifier(this->cache->sets_count * this->cache->associativity);
+}
+
+void Controller::enableReuseAnalysis(bool withDistance) {
+	if (this->reuseAnalyzer) return;
+	this->reuseAnalyzer = new ReuseAnalyzer(withDistance);
+}
+
+void Controller::writeReuseHistograms(const std::string& path) const {
+	if (!this->reuseAnalyzer) throw std::logic_error("reuse analysis is not enabled");
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		std::string err = std::format("Couldn't open file '{}'. Check if it exists and the path to the file is correct.", path);
+		throw std::runtime_error(err);
+	}
+	this->reuseAnalyzer->writeCsv(file);
+}
+
+void Controller::enablePrefetcher(PrefetcherKind kind, unsigned int degree, unsigned int delay) {
+	if (kind == noPrefetcher) return;
+	Prefetcher* prefetcher = Prefetcher::make(kind, degree);
+	delete this->prefetcher;
+	this->prefetcher = prefetcher;
+	this->config.prefetcher = kind;
+	this->config.prefetchDegree = degree;
+	this->config.prefetchDelay = delay;
+}
+
+void Controller::enableVictimCache(unsigned int entries) {
+	if (entries == 0) return;
+	VictimCache* victimCache = new VictimCache(entries);
+	delete this->victimCache;
+	this->victimCache = victimCache;
+	this->config.victimCacheEntries = entries;
+}
+
+void Controller::enableWriteBuffer(unsigned int entries) {
+	if (entries == 0) return;
+	WriteBuffer* writeBuffer = new WriteBuffer(entries, this->blockSize, this->storeSize);
+	delete this->writeBuffer;
+	this->writeBuffer = writeBuffer;
+	this->config.writeBufferEntries = entries;
+}
+
+void Controller::enableLatencyModel(unsigned int hitLatency, unsigned int memoryLatency, double bandwidth) {
+	LatencyModel* latencyModel = new LatencyModel(hitLatency, memoryLatency, bandwidth);
+	delete this->latencyModel;
+	this->latencyModel = latencyModel;
+	this->config.latencyModel = true;
+	this->config.hitLatency = hitLatency;
+	this->config.memoryLatency = memoryLatency;
+	this->config.bandwidth = bandwidth;
+}
+
+void Controller::writeLatencyHistogram(const std::string& path) const {
+	if (!this->latencyModel) throw std::logic_error("the latency model is not enabled");
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		std::string err = std::format("Couldn't open file '{}'. Check if it exists and the path to the file is correct.", path);
+		throw std::runtime_error(err);
+	}
+	this->latencyModel->writeCsv(file);
+}
+
+void Controller::enableTlb(const TlbConfig& tlbConfig) {
+	Tlb* tlb = new Tlb(tlbConfig);
+	delete this->tlb;
+	this->tlb = tlb;
+}
+
+void Controller::enableIntervalStats(unsigned long long interval, const std::string& path) {
+	if (this->intervalStats) return;
+	this->intervalStats = new IntervalStats(interval, path, this->blockSize);
+}
+
+void Controller::writeSetStats(const std::string& path) const {
+#ifndef CACHESIM_SET_STATS
+	throw std::logic_error("per set statistics need a build with CACHESIM_SET_STATS");
+#else
+	bool binary = path.ends_with(".bin");
+	std::ofstream file(path, binary ? std::ios::binary : std::ios::out);
+	if (!file.is_open()) {
+		std::string err = std::format("Couldn't open file '{}'. Check if it exists and the path to the file is correct.", path);
+		throw std::runtime_error(err);
+	}
+
+	// binary: "CSSS", u32 version, u32 set count, then per set 4 u64 counters in SetStats order (native byte order)
+	if (binary) {
+		unsigned int header[2] = { 1, this->cache->sets_count };
+		file.write("CSSS", 4);
+		file.write((const char*)header, sizeof(header));
+		for (unsigned int setIdx = 0; setIdx < this->cache->sets_count; setIdx++) {
+			const SetStats& set = this->cache->sets_stats[setIdx];
+			unsigned long long counters[4] = { set.accesses, set.misses, set.evictions, set.writebacks };
+			file.write((const char*)counters, sizeof(counters));
+		}
+		return;
+	}
+
+	file << "set,accesses,misses,evictions,writebacks\n";
+	for (unsigned int setIdx = 0; setIdx < this->cache->sets_count; setIdx++) {
+		const SetStats& set = this->cache->sets_stats[setIdx];
+		file << setIdx << ',' << set.accesses << ',' << set.misses << ',' << set.evictions << ',' << set.writebacks << '\n';
+	}
+#endif
+}
+
+const Config& Controller::getConfig() const {
+	return this->config;
+}
+
+const Stats& Controller::getStats() const {
+	return this->stats;
+}
+
+const MissClassifier* Controller::getMissClassifier() const {
+	return this->missClassifier;
+}
+
+const Tlb* Controller::getTlb() const {
+	return this->tlb;
+}
+
+unsigned long long Controller::cacheMemoryFootprint() const {
+	return this->cache->memoryFootprint();
+}
+
+std::string Controller::printResults() {
+	const Stats& s = this->stats;
+	std::string results = std::format("Results:\n  misses: {}\n  hits: {}\n  evictions: {}", s.misses, s.hits, s.evictions);
+	results += std::format("\nMemory traffic:\n  fills: {}\n  writebacks: {} (flushed at end: {})\n  clean evictions: {}\n  write throughs: {}", s.fills, s.writebacks, s.flushWritebacks, s.cleanEvictions, s.writeThroughs);
+	results += std::format("\n  fill bytes: {}\n  writeback bytes: {}\n  write through bytes: {}\n  total bytes: {}", s.fillBytes, s.writebackBytes, s.writeThroughBytes, s.fillBytes + s.writebackBytes + s.writeThroughBytes + s.prefetchBytes);
+	if (this->prefetcher) {
+		results += std::format("\nPrefetching ({}, degree {}):\n  prefetches: {}\n  prefetch bytes: {}\n  useful: {}\n  late: {}\n  useless: {}", Prefetcher::kindName(this->config.prefetcher), this->config.prefetchDegree, s.prefetches, s.prefetchBytes, s.usefulPrefetches, s.latePrefetches, s.uselessPrefetches);
+	}
+	if (this->config.sectors > 1) {
+		results += std::format("\nSectors ({} per cell, {} bytes):\n  line misses: {}\n  sector misses: {}", this->config.sectors, this->sectorSize, s.misses - s.sectorMisses, s.sectorMisses);
+	}
+	if (this->victimCache) {
+		results += std::format("\nVictim cache ({} cells):\n  hits: {}\n  hit rate: {:.4f}", this->config.victimCacheEntries, s.victimHits, s.misses ? (double)s.victimHits / s.misses : 0.0);
+	}
+	if (this->writeBuffer) {
+		results += std::format("\nWrite buffer ({} cells):\n  coalesced stores: {}\n  coalescing rate: {:.4f}\n  drains: {}\n  drained bytes: {}", this->config.writeBufferEntries, s.coalescedStores, s.writeThroughs ? (double)s.coalescedStores / s.writeThroughs : 0.0, s.bufferDrains, s.writeThroughBytes);
+	}
+	if (this->latencyModel) {
+		unsigned long long accesses = s.hits + s.misses;
+		results += std::format("\nLatency (hit {}, memory {} cycles):\n  cycles: {}\n  stall cycles: {}\n  average memory access time: {:.2f}", this->config.hitLatency, this->config.memoryLatency, s.cycles, s.stallCycles, accesses ? (double)s.cycles / accesses : 0.0);
+	}
+	if (this->tlb) {
+		const Tlb* t = this->tlb;
+		unsigned long long accesses = s.hits + s.misses;
+		results += std::format("\nTLB ({}):\n  dtlb misses: {}\n  stlb misses (page walks): {}\n  page walk memory references: {}", t->to_string(), t->dtlbMisses, t->stlbMisses, t->walkReferences);
+		if (t->getConfig().pwcEntries > 0) results += std::format("\n  page walk cache hits: {}", t->pwcHits);
+		results += std::format("\n  dtlb miss rate: {:.4f}", accesses ? (double)t->dtlbMisses / accesses : 0.0);
+	}
+	if (this->missClassifier) {
+		MissClassifier* c = this->missClassifier;
+		results += std::format("\nMiss classification:\n  compulsory: {}\n  capacity: {}\n  conflict: {}", c->compulsory, c->capacity, c->conflict);
+	}
+	return results;
+}
+
+deconstructedAddress Controller::deconstructAddress(unsigned long long address) {
+	// addresses are 64 bit wide, every address fits, the tag takes all bits above the index
+	unsigned long long indexMask = (1ULL << this->indexBits) - 1;
+	unsigned long long offsetMask = (1ULL << this->offsetBits) - 1;
+	unsigned long long tagMask = this->tagBits >= 64 ? ~0ULL : (1ULL << this->tagBits) - 1;
 	
-	// deconstruct offset
+	// deconstruct offset, the upper offset bits select the sector of a sectored cell
 	deconstructedAddress decAdd;
 	decAdd.offset = address & offsetMask;
+	decAdd.sector = decAdd.offset >> this->sectorOffsetBits;
 	address >>= this->offsetBits;
 
 	// deconstruct index
@@ -125,3 +681,173 @@ deconstructedAddress Controller::deconstructAddress(unsigned int address) {
 	return decAdd;
 }
 
+unsigned short Controller::sectorOf(const deconstructedAddress& a) const {
+	return (unsigned short)(1U << a.sector);
+}
+
+// a whole cell, or the sector of a sectored cell, is loaded from memory
+void Controller::fill() {
+	this->stats.fills++;
+	this->stats.fillBytes += this->sectorSize;
+	if (this->latencyModel) this->latencyModel->fill(this->sectorSize);
+}
+
+// the cycles of the access go into the counters
+void Controller::endAccess() {
+	unsigned long long cycles = this->latencyModel->end();
+	this->stats.cycles += cycles;
+	this->stats.stallCycles += cycles - this->latencyModel->getHitLatency();
+}
+
+void Controller::countEviction(const Cell& victim, unsigned int index) {
+	this->stats.evictions++;
+	if (victim.prefetched) this->stats.uselessPrefetches++;
+	SET_STATS(this->cache->sets_stats[index].evictions++);
+	if (this->victimCache) {
+		// the cell moves to the victim cache, the cell it displaces leaves the cache level instead
+		unsigned long long displacedBlock;
+		unsigned short displacedDirtySectors;
+		if (!this->victimCache->insert((victim.tag << this->indexBits) | index, victim.validSectors, victim.dirty ? victim.dirtySectors : 0, displacedBlock, displacedDirtySectors)) return;
+		this->countLeaving(displacedDirtySectors, displacedBlock & ((1ULL << this->indexBits) - 1));
+		return;
+	}
+	this->countLeaving(victim.dirty ? victim.dirtySectors : 0, index);
+}
+
+// a cell leaves the cache level, its dirty sectors are written back
+void Controller::countLeaving(unsigned short dirtySectors, unsigned int index) {
+	if (dirtySectors) {
+		this->stats.writebacks++;
+		SET_STATS(this->cache->sets_stats[index].writebacks++);
+		this->stats.writebackBytes += (unsigned long long)__builtin_popcount(dirtySectors) * this->sectorSize;
+		if (this->latencyModel) this->latencyModel->transfer((unsigned long long)__builtin_popcount(dirtySectors) * this->sectorSize);
+	}
+	else {
+		this->stats.cleanEvictions++;
+	}
+}
+
+// the block leaves the victim cache, the cell it replaces in the cache takes its slot
+// the miss was already counted, a sector missing in the victim cache is loaded like a sector miss
+bool Controller::victimCacheHit(const deconstructedAddress& a, unsigned short sector, bool isWrite) {
+	int slot = this->victimCache->find((a.tag << this->indexBits) | a.index);
+	if (this->latencyModel) this->latencyModel->probe();
+	if (slot < 0) return false;
+	this->stats.victimHits++;
+	unsigned short validSectors;
+	unsigned short dirtySectors;
+	this->victimCache->take(slot, validSectors, dirtySectors);
+
+	bool allocate = !isWrite || this->allocateOnWriteMiss;
+	if (!(validSectors & sector)) {
+		this->stats.sectorMisses++;
+		if (allocate) {
+			this->fill();
+			validSectors |= sector;
+		}
+	}
+	// the store stays in the cell, if its sector is there and written back later
+	if (isWrite && this->dirtyValueForWrite && (validSectors & sector)) {
+		dirtySectors |= sector;
+	}
+	else if (isWrite) {
+		this->countWriteThrough(a);
+	}
+
+	if (this->cache->isFull(a.index)) {
+		Cell victim = this->cache->evict(a.tag, a.index, a.offset, dirtySectors != 0, false, validSectors);
+		this->countEviction(victim, a.index);
+	}
+	else {
+		this->cache->set(a.tag, a.index, a.offset, dirtySectors != 0, true, false, validSectors);
+	}
+	// set/evict mark all sectors dirty
+	if (dirtySectors) this->cache->find(a.tag, a.index)->dirtySectors = dirtySectors;
+	return true;
+}
+
+// the store goes to memory, through the write buffer if there is one
+void Controller::countWriteThrough(const deconstructedAddress& a) {
+	this->stats.writeThroughs++;
+	if (!this->writeBuffer) {
+		this->stats.writeThroughBytes += this->storeSize;
+		if (this->latencyModel) this->latencyModel->transfer(this->storeSize);
+		return;
+	}
+	unsigned long long drainedBytes;
+	if (this->writeBuffer->store((a.tag << this->indexBits) | a.index, a.offset, drainedBytes)) this->stats.coalescedStores++;
+	if (drainedBytes == 0) return;
+	this->stats.bufferDrains++;
+	this->stats.writeThroughBytes += drainedBytes;
+	if (this->latencyModel) this->latencyModel->transfer(drainedBytes);
+}
+
+void Controller::classify(unsigned long long address, bool missed, bool allocate) {
+	this->missClassifier->access(address >> this->offsetBits, missed, allocate);
+}
+
+bool Controller::usePrefetched(const deconstructedAddress& a) {
+	Cell* cell = this->cache->find(a.tag, a.index);
+	if (!cell || !cell->prefetched) return false;
+	cell->prefetched = false;
+	this->stats.usefulPrefetches++;
+	return true;
+}
+
+// fills every prefetch whose delay has passed, the sets of the whole batch are prefetched before the first fill
+void Controller::issuePrefetches() {
+	this->accessClock++;
+	size_t ready = 0;
+	unsigned long long indexMask = (1ULL << this->indexBits) - 1;
+	while (ready < this->pendingPrefetches.size() && this->pendingPrefetches[ready].readyAt <= this->accessClock) {
+		this->cache->prefetchSet(this->pendingPrefetches[ready].block & indexMask);
+		ready++;
+	}
+
+	for (size_t i = 0; i < ready; i++) {
+		unsigned long long block = this->pendingPrefetches[i].block;
+		unsigned int index = block & indexMask;
+		unsigned long long tag = block >> this->indexBits;
+		// a demand access allocated the block in the meantime
+		if (this->cache->find(tag, index) || (this->victimCache && this->victimCache->find(block) >= 0)) continue;
+		this->stats.prefetches++;
+		this->stats.prefetchBytes += this->blockSize;
+		if (this->latencyModel) this->latencyModel->transfer(this->blockSize);
+		if (this->cache->isFull(index)) {
+			Cell victim = this->cache->evict(tag, index, 0, false, true, this->allSectors);
+			this->countEviction(victim, index);
+			continue;
+		}
+		this->cache->set(tag, index, 0, false, true, true, this->allSectors);
+	}
+	this->pendingPrefetches.erase(this->pendingPrefetches.begin(), this->pendingPrefetches.begin() + ready);
+}
+
+// queues the candidates of the prefetcher, blocks that are cached or already in flight are skipped
+void Controller::triggerPrefetcher(unsigned long long block, bool miss) {
+	if (miss) {
+		for (auto pending = this->pendingPrefetches.begin(); pending != this->pendingPrefetches.end(); pending++) {
+			if (pending->block != block) continue;
+			// the demand miss fetches the block itself
+			this->stats.latePrefetches++;
+			this->pendingPrefetches.erase(pending);
+			break;
+		}
+	}
+
+	this->prefetchCandidates.clear();
+	this->prefetcher->trigger(block, miss, this->prefetchCandidates);
+	unsigned long long indexMask = (1ULL << this->indexBits) - 1;
+	for (unsigned long long candidate : this->prefetchCandidates) {
+		if (this->pendingPrefetches.size() >= this->maxPendingPrefetches) break;
+		if (candidate == block || this->cache->find(candidate >> this->indexBits, candidate & indexMask)) continue;
+		bool inFlight = false;
+		for (const PendingPrefetch& pending : this->pendingPrefetches) {
+			if (pending.block == candidate) {
+				inFlight = true;
+				break;
+			}
+		}
+		if (!inFlight) this->pendingPrefetches.push_back({ candidate, this->accessClock + this->config.prefetchDelay });
+	}
+}
\ No newline at end of file
@@ -1,25 +1,117 @@
 #pragma once
+#include <deque>
+#include <span>
 #include <string>
+#include <vector>
+#include "Access.h"
 #include "Cache.h"
+#include "LatencyModel.h"
+#include "MissClassifier.h"
+#include "Prefetcher.h"
+#include "VictimCache.h"
+#include "WriteBuffer.h"
+#include "ReuseAnalyzer.h"
+#include "Tlb.h"
+
+class IntervalStats;
 
 enum WriteHitPolicy { writeThrough, writeBack };
 enum WriteMissPolicy { allocate, noAllocate };
 typedef struct deconstructedAddress {
 	int offset;
+	int sector;		// sector of a sectored cell, part of the offset
 	int index;
-	int tag;
+	unsigned long long tag;
 } deconstructedAddress;
 
+typedef struct Config {
+	unsigned int cellCount = 0;
+	unsigned int blockSize = 0;
+	unsigned int associativity = 0;
+	unsigned int setCount = 0;
+	EvictionPolicy evictionPolicy = LRU;
+	WriteHitPolicy writeHitPolicy = writeBack;
+	WriteMissPolicy writeMissPolicy = allocate;
+	PrefetcherKind prefetcher = noPrefetcher;
+	unsigned int prefetchDegree = 0;
+	unsigned int prefetchDelay = 0;		// accesses between a prefetch trigger and the fill
+	unsigned int victimCacheEntries = 0;	// 0: no victim cache
+	unsigned int sectors = 1;				// sectors per cell, 1: unsectored
+	unsigned int writeBufferEntries = 0;	// 0: no write buffer
+	bool latencyModel = false;
+	unsigned int hitLatency = 0;			// cycles
+	unsigned int memoryLatency = 0;			// cycles
+	double bandwidth = 0;					// memory bytes per cycle, 0: unlimited
+} Config;
+
+// counters are 64 bit, byte counts overflow 32 bit after a few million misses
+typedef struct Stats {
+	unsigned long long hits = 0;
+	unsigned long long misses = 0;
+	unsigned long long evictions = 0;
+	// memory traffic
+	unsigned long long writebacks = 0;		// dirty cells written back on eviction or flush
+	unsigned long long flushWritebacks = 0;	// part of writebacks, dirty cells left at the end of the trace
+	unsigned long long cleanEvictions = 0;	// evicted cells that did not need a write back
+	unsigned long long writeThroughs = 0;	// stores sent straight to memory (writeThrough hit or noAllocate miss)
+	unsigned long long fills = 0;			// cells loaded from memory
+	unsigned long long fillBytes = 0;
+	unsigned long long writebackBytes = 0;
+	unsigned long long writeThroughBytes = 0;
+	// prefetching, prefetch fills are not part of fills
+	unsigned long long prefetches = 0;			// cells filled by the prefetcher
+	unsigned long long prefetchBytes = 0;
+	unsigned long long usefulPrefetches = 0;	// prefetched cells hit by a demand access
+	unsigned long long latePrefetches = 0;		// demand misses on a block whose prefetch was still in flight
+	unsigned long long uselessPrefetches = 0;	// prefetched cells evicted before any demand access
+	// victim cache, evicted cells only leave the cache level (write back or clean eviction) once the victim cache drops them
+	unsigned long long victimHits = 0;			// misses served by the victim cache, part of misses but no fills
+	// sectored cells, fills and write backs move single sectors
+	unsigned long long sectorMisses = 0;		// misses on a cell that was there without the sector, part of misses
+	// write buffer, writeThroughBytes are the bytes drained from it
+	unsigned long long coalescedStores = 0;		// write throughs combined with an earlier store in the buffer
+	unsigned long long bufferDrains = 0;		// buffer entries written to memory
+	// latency model
+	unsigned long long cycles = 0;				// estimated cycles of all accesses
+	unsigned long long stallCycles = 0;			// part of cycles, beyond the hit latency
+} Stats;
+
+// a prefetch between its trigger and its fill
+typedef struct PendingPrefetch {
+	unsigned long long block;
+	unsigned long long readyAt;		// access clock at which the fill arrives
+} PendingPrefetch;
+
 class Controller {
 	Cache* cache;
-	int hits = 0;
-	int misses = 0;
-	int evictions = 0;
-	const int addressWidth = 32;
+	Config config;
+	Stats stats;
+	MissClassifier* missClassifier = 0;		// optional, only set if misses are classified
+	ReuseAnalyzer* reuseAnalyzer = 0;		// optional, only set if reuse is analyzed
+	IntervalStats* intervalStats = 0;		// optional, only set if interval statistics are written
+	Prefetcher* prefetcher = 0;				// optional, only set if prefetching is enabled
+	VictimCache* victimCache = 0;			// optional, only set if evicted cells go to a victim cache
+	WriteBuffer* writeBuffer = 0;			// optional, only set if write throughs are combined
+	LatencyModel* latencyModel = 0;			// optional, only set if cycles are estimated
+	Tlb* tlb = 0;							// optional, only set if address translation is simulated
+	std::deque<PendingPrefetch> pendingPrefetches;	// in fill order, the delay is the same for all
+	std::vector<unsigned long long> prefetchCandidates;
+	unsigned long long accessClock = 0;		// counted accesses, only advanced with a prefetcher
+	const size_t maxPendingPrefetches = 64;
+	// warmup: accesses that fill the cache before counting starts
+	unsigned long long warmupRemaining = 0;	// accesses left in the warmup, 0 once counting runs
+	bool warmupUntilFull = false;			// the warmup also ends once every set is full
+	bool fastForward = false;				// warmup accesses only update the cache, no counters or analyzers
+	IntervalStats* pendingIntervalStats = 0;	// interval statistics start after the warmup
+	const int addressWidth = 64;
+	const int storeSize = 4;		// bytes per store, the trace does not carry access sizes
 
 	int tagBits = 0;
 	int indexBits = 0;
 	int offsetBits = 0;
+	int sectorOffsetBits = 0;
+	unsigned int sectorSize = 0;
+	unsigned short allSectors = 1;
 	bool dirtyValueForWrite = true;
 	bool allocateOnWriteMiss = true;
 
@@ -28,12 +120,87 @@ class Controller {
 public:
 	Controller(unsigned int cellCount, unsigned int blockSize, unsigned int associativity, EvictionPolicy evictionPolicy, WriteHitPolicy writeHitPolicy, WriteMissPolicy writeMissPolicy);
 	~Controller();
-	void read(unsigned int address);
+	void read(unsigned long long address);
 
-	void write(unsigned int address);
+	void write(unsigned long long address);
+	// simulates the accesses in order, same result as read()/write() for each of them
+	// the sets of the following accesses are prefetched while the current one is simulated
+	void simulate(std::span<const Access> accesses);
+	// writes back all dirty cells and ends interval statistics, call once the trace has ended
+	void flush();
+	// splits every cell into "sectors" sectors, that are loaded and written back on their own, call before the first access
+	void setSectors(unsigned int sectors);
+	// the next "accesses" accesses (or, with untilFull, the accesses until every set is full) fill the cache
+	// but are not counted, counters, per set statistics and analyzers start after them
+	// fastForward: warmup accesses only update the cache, analyzers do not see them either
+	// call after loadState, a loaded cache can already be full
+	void setWarmup(unsigned long long accesses, bool untilFull, bool fastForward);
+	bool isWarmingUp() const;
+	// clears the cache, all counters and analyzers and cancels a warmup, the configuration stays,
+	// interval statistics emit the partial interval and continue in the same file
+	void reset();
+	// appends the versioned binary state: configuration, counters and cache contents (cells in LRU order,
+	// fifo positions, full flags, per set counters), miss classification and analyzers are not part of it
+	// throws if the victim cache, a prefetcher, the write buffer or the TLB is enabled
+	void saveState(std::string& state) const;
+	// throws the error of saveState up front, so a run does not fail only when its state is saved
+	void checkStateSaveable() const;
+	// restores a state written by saveState, the configuration has to match
+	void loadState(const char* data, size_t size);
+	// saveState into a file, written next to path and renamed, so readers never see half a state
+	void writeState(const std::string& path) const;
+	// loadState from a memory mapped file
+	void readState(const std::string& path);
+	// splits misses into compulsory, capacity and conflict misses from now on
+	void enableMissClassification();
+	// records reuse time (and reuse distance if withDistance) histograms from now on
+	void enableReuseAnalysis(bool withDistance);
+	void writeReuseHistograms(const std::string& path) const;
+	// attaches a prefetcher to the cache, its fills arrive "delay" accesses after the access that triggered them
+	void enablePrefetcher(PrefetcherKind kind, unsigned int degree, unsigned int delay);
+	// evicted cells go to a fully associative victim cache of "entries" cells, misses probe it
+	void enableVictimCache(unsigned int entries);
+	// write throughs go through a write combining buffer of "entries" blocks, flush() drains it
+	void enableWriteBuffer(unsigned int entries);
+	// estimates the cycles of every access from now on (average memory access time, stall cycles, histogram)
+	// bandwidth: memory bytes per cycle, 0 is unlimited
+	void enableLatencyModel(unsigned int hitLatency, unsigned int memoryLatency, double bandwidth);
+	void writeLatencyHistogram(const std::string& path) const;
+	// translates every access through a DTLB and STLB next to the data cache from now on
+	void enableTlb(const TlbConfig& tlbConfig);
+	// streams counter deltas of every "interval" accesses to path (csv, or jsonl if path ends with .jsonl)
+	void enableIntervalStats(unsigned long long interval, const std::string& path);
+	// per set counters as csv, or as binary if path ends with .bin
+	void writeSetStats(const std::string& path) const;
+	const Config& getConfig() const;
+	const Stats& getStats() const;
+	// 0 if misses are not classified
+	const MissClassifier* getMissClassifier() const;
+	// 0 if the TLB is not simulated
+	const Tlb* getTlb() const;
+	unsigned long long cacheMemoryFootprint() const;
 	std::string printResults();
 
 private:
-	deconstructedAddress deconstructAddress(unsigned int address);
+	deconstructedAddress deconstructAddress(unsigned long long address);
+	void readCounted(unsigned long long address);
+	void writeCounted(unsigned long long address);
+	void warmupAccess(unsigned long long address, bool isWrite);
+	void warm(unsigned long long address, bool isWrite);
+	void finishWarmup();
+	void fill();
+	void endAccess();
+	void countEviction(const Cell& victim, unsigned int index);
+	void countLeaving(unsigned short dirtySectors, unsigned int index);
+	// returns true if the victim cache held the block, it is then swapped back into the cache
+	bool victimCacheHit(const deconstructedAddress& a, unsigned short sector, bool isWrite);
+	// bit of the sector in the valid/dirty sector masks
+	unsigned short sectorOf(const deconstructedAddress& a) const;
+	// returns true if the demand access hits a prefetched cell, that cell counts as used from now on
+	bool usePrefetched(const deconstructedAddress& a);
+	void issuePrefetches();
+	void triggerPrefetcher(unsigned long long block, bool miss);
+	void countWriteThrough(const deconstructedAddress& a);
+	void classify(unsigned long long address, bool missed, bool allocate);
 
 };
\ No newline at end of file
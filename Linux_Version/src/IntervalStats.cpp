@@ -0,0 +1,63 @@
+#include "IntervalStats.h"
+#include <cmath>
+#include <cstring>
+#include <format>
+
+
+IntervalStats::IntervalStats(unsigned long long interval, const std::string& path, unsigned int blockSize) : writer(path) {
+	if (interval == 0) throw std::logic_error("interval must be bigger than 0");
+	this->interval = interval;
+	this->blockSize = blockSize;
+	this->jsonl = path.ends_with(".jsonl");
+	if (!this->jsonl) {
+		this->writer.write("interval,firstAccess,accesses,hits,misses,evictions,writebacks,missRate,workingSetBlocks,workingSetBytes\n");
+	}
+}
+
+void IntervalStats::resetCounters(const Stats& stats) {
+	if (this->accessesInInterval > 0) this->emit(stats);
+	this->last = Stats();
+}
+
+void IntervalStats::finish(const Stats& stats) {
+	if (this->accessesInInterval > 0) this->emit(stats);
+	this->writer.close();
+}
+
+// HyperLogLog estimate with linear counting for small sets
+unsigned long long IntervalStats::workingSetEstimate() const {
+	double m = registerCount;
+	double sum = 0;
+	unsigned int zeros = 0;
+	for (unsigned int idx = 0; idx < registerCount; idx++) {
+		sum += std::ldexp(1.0, -this->registers[idx]);
+		if (this->registers[idx] == 0) zeros++;
+	}
+	double estimate = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+	if (estimate <= 2.5 * m && zeros > 0) estimate = m * std::log(m / zeros);
+	return std::llround(estimate);
+}
+
+void IntervalStats::emit(const Stats& stats) {
+	unsigned long long hits = stats.hits - this->last.hits;
+	unsigned long long misses = stats.misses - this->last.misses;
+	unsigned long long evictions = stats.evictions - this->last.evictions;
+	unsigned long long writebacks = stats.writebacks - this->last.writebacks;
+	double missRate = (double)misses / (double)this->accessesInInterval;
+	unsigned long long workingSet = this->workingSetEstimate();
+
+	if (this->jsonl) {
+		this->writer.write(std::format("{{\"interval\":{},\"firstAccess\":{},\"accesses\":{},\"hits\":{},\"misses\":{},\"evictions\":{},\"writebacks\":{},\"missRate\":{:.6f},\"workingSetBlocks\":{},\"workingSetBytes\":{}}}\n",
+			this->intervalIdx, this->accessesBefore, this->accessesInInterval, hits, misses, evictions, writebacks, missRate, workingSet, workingSet * this->blockSize));
+	}
+	else {
+		this->writer.write(std::format("{},{},{},{},{},{},{},{:.6f},{},{}\n",
+			this->intervalIdx, this->accessesBefore, this->accessesInInterval, hits, misses, evictions, writebacks, missRate, workingSet, workingSet * this->blockSize));
+	}
+
+	this->last = stats;
+	this->intervalIdx++;
+	this->accessesBefore += this->accessesInInterval;
+	this->accessesInInterval = 0;
+	std::memset(this->registers, 0, sizeof(this->registers));
+}
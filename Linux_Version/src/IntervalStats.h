@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include "AsyncWriter.h"
+#include "Controller.h"
+
+// emits the counter deltas of every interval of N accesses as a csv or jsonl (path ends with .jsonl) row
+// the working set of an interval (unique blocks) is estimated with a HyperLogLog sketch
+class IntervalStats {
+public:
+	IntervalStats(unsigned long long interval, const std::string& path, unsigned int blockSize);
+	// called before every access, stats are the counters before the access
+	void access(unsigned long long block, const Stats& stats) {
+		if (this->accessesInInterval == this->interval) this->emit(stats);
+		this->accessesInInterval++;
+		this->sketchAdd(block);
+	}
+	// emits the (partial) interval with the counters before they were reset, the next interval starts from zero
+	void resetCounters(const Stats& stats);
+	// emits the last (partial) interval and closes the file
+	void finish(const Stats& stats);
+
+private:
+	static const unsigned int registerBits = 12;
+	static const unsigned int registerCount = 1 << registerBits;
+
+	AsyncWriter writer;
+	bool jsonl = false;
+	unsigned long long interval = 0;
+	unsigned int blockSize = 0;
+	unsigned long long intervalIdx = 0;
+	unsigned long long accessesInInterval = 0;
+	unsigned long long accessesBefore = 0;
+	Stats last;
+	unsigned char registers[registerCount] = {};
+
+	void sketchAdd(unsigned long long block) {
+		unsigned long long hash = block * 0x9E3779B97F4A7C15ULL;
+		hash ^= hash >> 29;
+		hash *= 0xBF58476D1CE4E5B9ULL;
+		hash ^= hash >> 32;
+		unsigned int idx = hash >> (64 - registerBits);
+		unsigned char rank = __builtin_clzll((hash << registerBits) | (1ULL << (registerBits - 1))) + 1;
+		if (rank > this->registers[idx]) this->registers[idx] = rank;
+	}
+	unsigned long long workingSetEstimate() const;
+	void emit(const Stats& stats);
+};
@@ -0,0 +1,46 @@
+#include "LatencyModel.h"
+#include <bit>
+#include <cmath>
+#include <stdexcept>
+
+
+LatencyModel::LatencyModel(unsigned int hitLatency, unsigned int memoryLatency, double bytesPerCycle) {
+	if (bytesPerCycle < 0) throw std::invalid_argument("bandwidth can not be negative");
+	this->hitLatency = hitLatency;
+	this->memoryLatency = memoryLatency;
+	this->cyclesPerByte = bytesPerCycle > 0 ? 1.0 / bytesPerCycle : 0.0;
+}
+
+void LatencyModel::fill(unsigned int bytes) {
+	if (this->cyclesPerByte == 0) {
+		this->current += this->memoryLatency;
+		return;
+	}
+	double issue = this->now + this->current;
+	double start = std::max(issue, this->busFreeAt);
+	double transfer = bytes * this->cyclesPerByte;
+	this->busFreeAt = start + transfer;
+	this->current += (start - issue) + this->memoryLatency + transfer;
+}
+
+void LatencyModel::transfer(unsigned long long bytes) {
+	if (this->cyclesPerByte == 0) return;
+	this->busFreeAt = std::max(this->now + this->current, this->busFreeAt) + bytes * this->cyclesPerByte;
+}
+
+unsigned long long LatencyModel::end() {
+	unsigned long long cycles = std::llround(this->current);
+	this->now += this->current;
+	this->current = 0;
+	this->histogram[std::bit_width(cycles)]++;
+	return cycles;
+}
+
+void LatencyModel::writeCsv(std::ostream& stream) const {
+	stream << "bucket,min,max,accesses\n";
+	for (unsigned int b = 0; b < bucketCount; b++) {
+		unsigned long long min = b == 0 ? 0 : 1ULL << (b - 1);
+		unsigned long long max = b == 0 ? 0 : min + (min - 1);
+		stream << b << ',' << min << ',' << max << ',' << this->histogram[b] << '\n';
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <algorithm>
+#include <ostream>
+
+// estimates the cycles of every access for a blocking in-order core, the trace has no instruction timing
+// + hit: hitLatency
+// + demand fill (read miss, write allocate miss, sector miss): hitLatency + memoryLatency,
+//   with a bandwidth cap also the wait for the memory bus and the transfer of the fill
+// + victim cache hit: two hit latencies
+// write backs, write throughs and prefetch fills only occupy the memory bus, they do not stall the access
+// the access path calls begin, the fill/transfer events, then end, nothing is recomputed afterwards
+// bucket 0 of the histogram counts the value 0, bucket b counts values in [2^(b-1), 2^b)
+class LatencyModel {
+public:
+	static const unsigned int bucketCount = 65;
+	unsigned long long histogram[bucketCount] = {};
+
+	// bytesPerCycle: memory bandwidth cap, 0 is unlimited
+	LatencyModel(unsigned int hitLatency, unsigned int memoryLatency, double bytesPerCycle);
+	void begin() { this->current = this->hitLatency; }
+	// a demand fill of "bytes" bytes, the access waits for it
+	void fill(unsigned int bytes);
+	// a probe of the next structure after a miss, e.g. the victim cache
+	void probe() { this->current += this->hitLatency; }
+	// memory traffic the access does not wait for
+	void transfer(unsigned long long bytes);
+	// returns the cycles of the access and adds them to the histogram
+	unsigned long long end();
+	unsigned int getHitLatency() const { return this->hitLatency; }
+	void writeCsv(std::ostream& stream) const;
+	// zeroes the histogram, the clock and the memory bus stay
+	void clearCounters() {
+		std::fill(this->histogram, this->histogram + bucketCount, 0ULL);
+	}
+
+private:
+	unsigned int hitLatency;
+	unsigned int memoryLatency;
+	double cyclesPerByte = 0;	// 0 without bandwidth cap
+	double now = 0;				// cycle the current access started at
+	double busFreeAt = 0;		// cycle the memory bus finishes its queued transfers
+	double current = 0;			// cycles of the current access so far
+};
@@ -0,0 +1,87 @@
+#include "MissClassifier.h"
+
+
+MissClassifier::MissClassifier(unsigned int cellCount) : shadowIdx(cellCount) {
+	this->shadowCapacity = cellCount;
+	this->shadowNodes.reserve(cellCount);
+}
+
+void MissClassifier::access(unsigned long long block, bool missed, bool allocate) {
+	// a block is only touched once it is in the cache, a noAllocate write miss leaves the next miss compulsory
+	bool touchedBefore = this->touch(block, !missed || allocate);
+	bool shadowHit = this->shadowAccess(block, allocate);
+	if (!missed) return;
+
+	if (!touchedBefore) this->compulsory++;
+	else if (!shadowHit) this->capacity++;
+	else this->conflict++;
+}
+
+bool MissClassifier::touch(unsigned long long block, bool mark) {
+	unsigned long long page = block >> pageBits;
+	if (page != this->lastPage) {
+		bool inserted;
+		unsigned int& pageIdx = this->touchedPageIdx.insert(page, inserted);
+		if (inserted) {
+			pageIdx = this->touchedPages.size();
+			this->touchedPages.emplace_back((1ULL << pageBits) / 64, 0);
+		}
+		this->lastPage = page;
+		this->lastPageBits = this->touchedPages[pageIdx].data();
+	}
+
+	unsigned long long bit = block & ((1ULL << pageBits) - 1);
+	unsigned long long& word = this->lastPageBits[bit / 64];
+	unsigned long long bitMask = 1ULL << (bit % 64);
+	bool touchedBefore = word & bitMask;
+	if (mark) word |= bitMask;
+	return touchedBefore;
+}
+
+bool MissClassifier::shadowAccess(unsigned long long block, bool allocate) {
+	unsigned int* found = this->shadowIdx.find(block);
+	// HIT: move to front
+	if (found) {
+		unsigned int node = *found;
+		if (node != this->mru) {
+			this->unlink(node);
+			this->pushFront(node);
+		}
+		return true;
+	}
+	if (!allocate) return false;
+
+	// MISS: take a free node or replace the least recently used one
+	unsigned int node;
+	if (this->shadowNodes.size() < this->shadowCapacity) {
+		node = this->shadowNodes.size();
+		this->shadowNodes.push_back({ block, none, none });
+	}
+	else {
+		node = this->lru;
+		this->unlink(node);
+		this->shadowIdx.erase(this->shadowNodes[node].block);
+		this->shadowNodes[node].block = block;
+	}
+	bool inserted;
+	this->shadowIdx.insert(block, inserted) = node;
+	this->pushFront(node);
+	return false;
+}
+
+void MissClassifier::unlink(unsigned int node) {
+	ShadowNode& n = this->shadowNodes[node];
+	if (n.prev != none) this->shadowNodes[n.prev].next = n.next;
+	else this->mru = n.next;
+	if (n.next != none) this->shadowNodes[n.next].prev = n.prev;
+	else this->lru = n.prev;
+}
+
+void MissClassifier::pushFront(unsigned int node) {
+	ShadowNode& n = this->shadowNodes[node];
+	n.prev = none;
+	n.next = this->mru;
+	if (this->mru != none) this->shadowNodes[this->mru].prev = node;
+	this->mru = node;
+	if (this->lru == none) this->lru = node;
+}
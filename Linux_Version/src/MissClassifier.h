@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include "BlockMap.h"
+
+// splits misses into compulsory, capacity and conflict misses (3C model)
+// + compulsory: miss on a block that was never in the cache
+// + capacity: block would also miss in a fully associative LRU cache of the same size
+// + conflict: all other misses, caused by the mapping of blocks to sets
+class MissClassifier {
+public:
+	unsigned long long compulsory = 0;
+	unsigned long long capacity = 0;
+	unsigned long long conflict = 0;
+
+	MissClassifier(unsigned int cellCount);
+	// zeroes the counters, the first touches and the shadow cache stay
+	void clearCounters() {
+		this->compulsory = 0;
+		this->capacity = 0;
+		this->conflict = 0;
+	}
+	// called for every access with the block address (address without offset)
+	// missed: access missed in the simulated cache
+	// allocate: a miss loads the block into the cache (false for noAllocate writes)
+	void access(unsigned long long block, bool missed, bool allocate);
+
+private:
+	// first touch bitmap, split in pages that are allocated on first use
+	static const unsigned int pageBits = 16;
+	BlockMap<unsigned int> touchedPageIdx;		// page number -> index into touchedPages
+	std::vector<std::vector<unsigned long long>> touchedPages;
+	unsigned long long lastPage = BlockMap<unsigned int>::emptyKey;
+	unsigned long long* lastPageBits = 0;
+
+	// shadow fully associative LRU cache, hash map into an intrusive list of nodes
+	typedef struct ShadowNode {
+		unsigned long long block;
+		unsigned int prev;
+		unsigned int next;
+	} ShadowNode;
+	static const unsigned int none = ~0U;
+	BlockMap<unsigned int> shadowIdx;				// block -> index into shadowNodes
+	std::vector<ShadowNode> shadowNodes;
+	unsigned int shadowCapacity = 0;
+	unsigned int mru = none;
+	unsigned int lru = none;
+
+	// return true if the block was in the cache before, mark: it is in the cache now
+	bool touch(unsigned long long block, bool mark);
+	// return true if block was in the shadow cache
+	bool shadowAccess(unsigned long long block, bool allocate);
+	void unlink(unsigned int node);
+	void pushFront(unsigned int node);
+};
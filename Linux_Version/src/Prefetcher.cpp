@@ -0,0 +1,113 @@
+#include "Prefetcher.h"
+#include <format>
+#include <stdexcept>
+
+
+Prefetcher* Prefetcher::make(PrefetcherKind kind, unsigned int degree) {
+	if (degree == 0) throw std::invalid_argument("prefetch degree has to be at least 1");
+	switch (kind) {
+	case nextLinePrefetcher: return new NextLinePrefetcher(degree);
+	case stridePrefetcher: return new StridePrefetcher(degree);
+	case streamPrefetcher: return new StreamPrefetcher(degree);
+	default: return 0;
+	}
+}
+
+PrefetcherKind Prefetcher::parseKind(const std::string& name) {
+	if (name == "none") return noPrefetcher;
+	if (name == "nextline") return nextLinePrefetcher;
+	if (name == "stride") return stridePrefetcher;
+	if (name == "stream") return streamPrefetcher;
+	std::string err = std::format("prefetcher({}) is not none, nextline, stride or stream", name);
+	throw std::invalid_argument(err);
+}
+
+const char* Prefetcher::kindName(PrefetcherKind kind) {
+	switch (kind) {
+	case nextLinePrefetcher: return "nextline";
+	case stridePrefetcher: return "stride";
+	case streamPrefetcher: return "stream";
+	default: return "none";
+	}
+}
+
+void NextLinePrefetcher::trigger(unsigned long long block, bool, std::vector<unsigned long long>& candidates) {
+	for (unsigned int i = 1; i <= this->degree; i++) candidates.push_back(block + i);
+}
+
+void StridePrefetcher::trigger(unsigned long long block, bool, std::vector<unsigned long long>& candidates) {
+	unsigned long long region = block >> regionBits;
+	StrideEntry& entry = this->table[(region * 0x9E3779B97F4A7C15ULL) >> 58];
+	if (entry.region != region) {
+		entry.region = region;
+		entry.lastBlock = block;
+		entry.stride = 0;
+		entry.confidence = 0;
+		return;
+	}
+
+	long long stride = (long long)(block - entry.lastBlock);
+	entry.lastBlock = block;
+	if (stride == 0) return;
+	if (stride == entry.stride) {
+		if (entry.confidence < 3) entry.confidence++;
+	}
+	else {
+		// a single other stride lowers the confidence, a second one replaces the stride
+		if (entry.confidence > 0) entry.confidence--;
+		if (entry.confidence == 0) entry.stride = stride;
+	}
+	if (entry.confidence < 1) return;
+	for (unsigned int i = 1; i <= this->degree; i++) candidates.push_back(block + entry.stride * (long long)i);
+}
+
+void StreamPrefetcher::prefetchAhead(Stream& stream, unsigned long long block, std::vector<unsigned long long>& candidates) {
+	unsigned long long target = block + (long long)stream.direction * this->depth;
+	// only blocks beyond what the stream prefetched already
+	unsigned long long next = stream.prefetchedUpTo;
+	bool ahead = stream.direction > 0 ? next > block : next < block;
+	if (!ahead) next = block;
+	while (next != target) {
+		next += stream.direction;
+		candidates.push_back(next);
+	}
+	stream.prefetchedUpTo = target;
+}
+
+void StreamPrefetcher::trigger(unsigned long long block, bool miss, std::vector<unsigned long long>& candidates) {
+	this->time++;
+	Stream* training = 0;
+	Stream* oldest = &this->streams[0];
+	for (Stream& stream : this->streams) {
+		if (!stream.valid) {
+			if (oldest->valid) oldest = &stream;
+			continue;
+		}
+		long long distance = (long long)(block - stream.lastBlock);
+		// confirmed stream: the access lies within its prefetch window
+		if (stream.direction != 0 && distance * stream.direction > 0 && distance * stream.direction <= (long long)this->depth) {
+			stream.lastBlock = block;
+			stream.lastUse = this->time;
+			this->prefetchAhead(stream, block, candidates);
+			return;
+		}
+		if (stream.direction == 0 && distance != 0 && distance >= -2 && distance <= 2) training = &stream;
+		if (oldest->valid && stream.lastUse < oldest->lastUse) oldest = &stream;
+	}
+
+	// second miss next to a training stream sets its direction
+	if (training && miss) {
+		training->direction = (long long)(block - training->lastBlock) > 0 ? 1 : -1;
+		training->lastBlock = block;
+		training->prefetchedUpTo = block;
+		training->lastUse = this->time;
+		this->prefetchAhead(*training, block, candidates);
+		return;
+	}
+	if (!miss) return;
+
+	*oldest = Stream();
+	oldest->valid = true;
+	oldest->lastBlock = block;
+	oldest->lastUse = this->time;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <vector>
+
+enum PrefetcherKind { noPrefetcher, nextLinePrefetcher, stridePrefetcher, streamPrefetcher };
+
+// hardware prefetcher model attached to the cache, works on block addresses (address without offset)
+// it only runs on trigger events: demand misses and the first demand hit of a prefetched cell,
+// the controller queues the candidates and inserts them in batches once their delay has passed
+class Prefetcher {
+public:
+	virtual ~Prefetcher() {}
+	// appends the blocks to prefetch after an access to block to candidates (miss: false for a hit on a prefetched cell)
+	virtual void trigger(unsigned long long block, bool miss, std::vector<unsigned long long>& candidates) = 0;
+
+	// degree: next-N-line: N, stride: prefetches per detected stride, stream: depth (blocks ahead of the stream)
+	static Prefetcher* make(PrefetcherKind kind, unsigned int degree);
+	// none|nextline|stride|stream
+	static PrefetcherKind parseKind(const std::string& name);
+	static const char* kindName(PrefetcherKind kind);
+};
+
+// blocks block + 1 ... block + degree
+class NextLinePrefetcher : public Prefetcher {
+public:
+	NextLinePrefetcher(unsigned int degree) : degree(degree) {}
+	void trigger(unsigned long long block, bool miss, std::vector<unsigned long long>& candidates) override;
+
+private:
+	unsigned int degree;
+};
+
+// reference prediction table indexed by region (traces carry no pc), an entry learns the stride between
+// trigger events in its region and prefetches once the same stride was seen twice in a row
+class StridePrefetcher : public Prefetcher {
+public:
+	StridePrefetcher(unsigned int degree) : degree(degree) {}
+	void trigger(unsigned long long block, bool miss, std::vector<unsigned long long>& candidates) override;
+
+private:
+	static const unsigned int regionBits = 8;		// blocks per region: 256
+	static const unsigned int tableSize = 64;
+
+	typedef struct StrideEntry {
+		unsigned long long region = ~0ULL;
+		unsigned long long lastBlock = 0;
+		long long stride = 0;
+		unsigned int confidence = 0;
+	} StrideEntry;
+
+	unsigned int degree;
+	StrideEntry table[tableSize];
+};
+
+// stream buffers: a miss next to an earlier miss confirms a stream and its direction,
+// the stream is then kept "depth" blocks ahead of the demand accesses that follow it
+class StreamPrefetcher : public Prefetcher {
+public:
+	StreamPrefetcher(unsigned int depth) : depth(depth) {}
+	void trigger(unsigned long long block, bool miss, std::vector<unsigned long long>& candidates) override;
+
+private:
+	static const unsigned int streamCount = 8;
+
+	typedef struct Stream {
+		unsigned long long lastBlock = 0;
+		unsigned long long prefetchedUpTo = 0;	// furthest block prefetched
+		int direction = 0;						// 0 while training, else +1 or -1
+		unsigned long long lastUse = 0;
+		bool valid = false;
+	} Stream;
+
+	unsigned int depth;
+	unsigned long long time = 0;
+	Stream streams[streamCount];
+
+	void prefetchAhead(Stream& stream, unsigned long long block, std::vector<unsigned long long>& candidates);
+};
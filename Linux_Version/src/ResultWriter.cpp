@@ -0,0 +1,255 @@
+#include "ResultWriter.h"
+#include <charconv>
+#include <format>
+
+
+// streams one field at a time in the chosen format
+class FieldWriter {
+public:
+	enum Mode { json, csvHeader, csvValues };
+
+	FieldWriter(std::ostream& stream, Mode mode) : stream(stream) {
+		this->mode = mode;
+	}
+
+	// json nests fields in groups, csv ignores them
+	void beginGroup(const char* name) {
+		if (this->mode != json) return;
+		this->separate();
+		this->stream << '"' << name << "\":{";
+		this->first = true;
+	}
+	void endGroup() {
+		if (this->mode != json) return;
+		this->stream << '}';
+		this->first = false;
+	}
+
+	void field(const char* name, unsigned long long value) {
+		if (this->name(name)) this->stream << value;
+	}
+	void field(const char* name, double value) {
+		if (!this->name(name)) return;
+		char buffer[32];
+		std::to_chars_result res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+		this->stream.write(buffer, res.ptr - buffer);
+	}
+	void field(const char* name, const std::string& value) {
+		if (!this->name(name)) return;
+		if (this->mode == json) this->stream << '"';
+		static const char digits[] = "0123456789abcdef";
+		for (char c : value) {
+			// control characters (a tab or newline in a path) are not allowed in json strings
+			if (this->mode == json && (unsigned char)c < 0x20) {
+				this->stream << "\\u00" << digits[c >> 4] << digits[c & 15];
+				continue;
+			}
+			if (this->mode == json && (c == '"' || c == '\\')) this->stream << '\\';
+			if (this->mode != json && c == ',') c = ';';
+			this->stream << c;
+		}
+		if (this->mode == json) this->stream << '"';
+	}
+
+private:
+	std::ostream& stream;
+	Mode mode;
+	bool first = true;
+
+	void separate() {
+		if (!this->first) this->stream << ',';
+		this->first = false;
+	}
+	// writes the field name, return true if the value has to be written too
+	bool name(const char* name) {
+		this->separate();
+		if (this->mode == json) this->stream << '"' << name << "\":";
+		if (this->mode == csvHeader) this->stream << name;
+		return this->mode != csvHeader;
+	}
+};
+
+static std::string to_string(EvictionPolicy policy) {
+	switch (policy) {
+	case random: return "random";
+	case fifo: return "fifo";
+	case LRU: return "LRU";
+	}
+	return "";
+}
+
+static std::string to_string(WriteHitPolicy policy) {
+	return policy == writeThrough ? "writeThrough" : "writeBack";
+}
+
+static std::string to_string(WriteMissPolicy policy) {
+	return policy == allocate ? "allocate" : "noAllocate";
+}
+
+// 0 instead of nan for empty traces, json has no nan
+static double ratio(unsigned long long a, unsigned long long b) {
+	return b == 0 ? 0.0 : (double)a / (double)b;
+}
+
+static void writeFields(FieldWriter& w, Controller& controller, const RunInfo& run) {
+	const Config& c = controller.getConfig();
+	const Stats& s = controller.getStats();
+	unsigned long long accesses = s.hits + s.misses;
+	unsigned long long totalBytes = s.fillBytes + s.writebackBytes + s.writeThroughBytes + s.prefetchBytes;
+
+	w.beginGroup("config");
+	w.field("trace", run.trace);
+	w.field("cellCount", (unsigned long long)c.cellCount);
+	w.field("blockSize", (unsigned long long)c.blockSize);
+	w.field("associativity", (unsigned long long)c.associativity);
+	w.field("setCount", (unsigned long long)c.setCount);
+	w.field("cacheBytes", (unsigned long long)c.cellCount * c.blockSize);
+	w.field("evictionPolicy", to_string(c.evictionPolicy));
+	w.field("writeHitPolicy", to_string(c.writeHitPolicy));
+	w.field("writeMissPolicy", to_string(c.writeMissPolicy));
+	if (c.prefetcher != noPrefetcher) {
+		w.field("prefetcher", std::string(Prefetcher::kindName(c.prefetcher)));
+		w.field("prefetchDegree", (unsigned long long)c.prefetchDegree);
+		w.field("prefetchDelay", (unsigned long long)c.prefetchDelay);
+	}
+	if (c.victimCacheEntries > 0) w.field("victimCacheEntries", (unsigned long long)c.victimCacheEntries);
+	if (c.writeBufferEntries > 0) w.field("writeBufferEntries", (unsigned long long)c.writeBufferEntries);
+	if (c.latencyModel) {
+		w.field("hitLatency", (unsigned long long)c.hitLatency);
+		w.field("memoryLatency", (unsigned long long)c.memoryLatency);
+		w.field("bandwidth", c.bandwidth);
+	}
+	const Tlb* tlb = controller.getTlb();
+	if (tlb) {
+		const TlbConfig& t = tlb->getConfig();
+		w.field("pageSize", t.pageSize);
+		w.field("dtlbEntries", (unsigned long long)t.dtlbEntries);
+		w.field("dtlbWays", (unsigned long long)t.dtlbWays);
+		w.field("stlbEntries", (unsigned long long)t.stlbEntries);
+		w.field("stlbWays", (unsigned long long)t.stlbWays);
+		w.field("pwcEntries", (unsigned long long)t.pwcEntries);
+	}
+	if (c.sectors > 1) {
+		w.field("sectors", (unsigned long long)c.sectors);
+		w.field("sectorSize", (unsigned long long)(c.blockSize / c.sectors));
+	}
+	w.endGroup();
+
+	w.beginGroup("counters");
+	w.field("accesses", accesses);
+	w.field("hits", s.hits);
+	w.field("misses", s.misses);
+	w.field("evictions", s.evictions);
+	w.field("writebacks", s.writebacks);
+	w.field("flushWritebacks", s.flushWritebacks);
+	w.field("cleanEvictions", s.cleanEvictions);
+	w.field("writeThroughs", s.writeThroughs);
+	w.field("fills", s.fills);
+	w.field("fillBytes", s.fillBytes);
+	w.field("writebackBytes", s.writebackBytes);
+	w.field("writeThroughBytes", s.writeThroughBytes);
+	if (c.prefetcher != noPrefetcher) {
+		w.field("prefetches", s.prefetches);
+		w.field("prefetchBytes", s.prefetchBytes);
+		w.field("usefulPrefetches", s.usefulPrefetches);
+		w.field("latePrefetches", s.latePrefetches);
+		w.field("uselessPrefetches", s.uselessPrefetches);
+	}
+	if (c.victimCacheEntries > 0) w.field("victimHits", s.victimHits);
+	if (c.writeBufferEntries > 0) {
+		w.field("coalescedStores", s.coalescedStores);
+		w.field("bufferDrains", s.bufferDrains);
+		w.field("drainedBytes", s.writeThroughBytes);
+	}
+	if (c.latencyModel) {
+		w.field("cycles", s.cycles);
+		w.field("stallCycles", s.stallCycles);
+	}
+	if (tlb) {
+		w.field("dtlbMisses", tlb->dtlbMisses);
+		w.field("stlbMisses", tlb->stlbMisses);
+		w.field("walkReferences", tlb->walkReferences);
+		w.field("pwcHits", tlb->pwcHits);
+	}
+	if (c.sectors > 1) {
+		w.field("lineMisses", s.misses - s.sectorMisses);
+		w.field("sectorMisses", s.sectorMisses);
+	}
+	w.field("totalBytes", totalBytes);
+	const MissClassifier* classifier = controller.getMissClassifier();
+	if (classifier) {
+		w.field("compulsoryMisses", classifier->compulsory);
+		w.field("capacityMisses", classifier->capacity);
+		w.field("conflictMisses", classifier->conflict);
+	}
+	w.endGroup();
+
+	w.beginGroup("derived");
+	w.field("hitRate", ratio(s.hits, accesses));
+	w.field("missRate", ratio(s.misses, accesses));
+	w.field("bytesPerAccess", ratio(totalBytes, accesses));
+	if (c.prefetcher != noPrefetcher) {
+		w.field("prefetchAccuracy", ratio(s.usefulPrefetches, s.prefetches));
+		w.field("prefetchCoverage", ratio(s.usefulPrefetches, s.usefulPrefetches + s.misses));
+	}
+	if (c.victimCacheEntries > 0) w.field("victimHitRate", ratio(s.victimHits, s.misses));
+	if (c.writeBufferEntries > 0) w.field("coalescingRate", ratio(s.coalescedStores, s.writeThroughs));
+	if (c.latencyModel) w.field("amat", ratio(s.cycles, accesses));
+	if (tlb) {
+		w.field("dtlbMissRate", ratio(tlb->dtlbMisses, accesses));
+		w.field("stlbMissRate", ratio(tlb->stlbMisses, tlb->dtlbMisses));
+	}
+	w.endGroup();
+
+	w.beginGroup("runtime");
+	w.field("seconds", run.runtimeSeconds);
+	w.field("accessesPerSecond", run.runtimeSeconds > 0 ? accesses / run.runtimeSeconds : 0.0);
+	w.field("droppedAccesses", run.droppedAccesses);
+	if (run.timing) {
+		w.field("ioWallSeconds", run.io.wallSeconds);
+		w.field("ioCpuSeconds", run.io.cpuSeconds);
+		w.field("parseWallSeconds", run.parse.wallSeconds);
+		w.field("parseCpuSeconds", run.parse.cpuSeconds);
+		w.field("simulationWallSeconds", run.simulation.wallSeconds);
+		w.field("simulationCpuSeconds", run.simulation.cpuSeconds);
+		w.field("nsPerAccess", accesses > 0 ? run.simulation.wallSeconds * 1e9 / accesses : 0.0);
+		w.field("peakRssBytes", run.peakRssBytes);
+		w.field("cacheBytes", run.cacheBytes);
+	}
+	w.endGroup();
+}
+
+void writeResults(std::ostream& stream, OutputFormat format, Controller& controller, const RunInfo& run) {
+	if (format == textOutput) {
+		stream << controller.printResults();
+		return;
+	}
+
+	if (format == jsonOutput) {
+		FieldWriter json(stream, FieldWriter::json);
+		stream << '{';
+		writeFields(json, controller, run);
+		stream << "}\n";
+		return;
+	}
+
+	FieldWriter header(stream, FieldWriter::csvHeader);
+	writeFields(header, controller, run);
+	stream << '\n';
+	FieldWriter values(stream, FieldWriter::csvValues);
+	writeFields(values, controller, run);
+	stream << '\n';
+}
+
+void writeTimingReport(std::ostream& stream, Controller& controller, const RunInfo& run) {
+	const Stats& s = controller.getStats();
+	unsigned long long accesses = s.hits + s.misses;
+	stream << std::format("Timing:\n  {:<12}{:>12}{:>12}\n", "phase", "wall [s]", "cpu [s]");
+	stream << std::format("  {:<12}{:>12.4f}{:>12.4f}\n", "trace io", run.io.wallSeconds, run.io.cpuSeconds);
+	stream << std::format("  {:<12}{:>12.4f}{:>12.4f}\n", "parsing", run.parse.wallSeconds, run.parse.cpuSeconds);
+	stream << std::format("  {:<12}{:>12.4f}{:>12.4f}\n", "simulation", run.simulation.wallSeconds, run.simulation.cpuSeconds);
+	stream << std::format("  {:<12}{:>12.4f}\n", "total", run.runtimeSeconds);
+	stream << std::format("  accesses per second: {:.0f}\n", run.runtimeSeconds > 0 ? accesses / run.runtimeSeconds : 0.0);
+	stream << std::format("  ns per access (simulation): {:.2f}\n", accesses > 0 ? run.simulation.wallSeconds * 1e9 / accesses : 0.0);
+	stream << std::format("  peak rss: {} bytes\n  cache memory: {} bytes\n", run.peakRssBytes, run.cacheBytes);
+}
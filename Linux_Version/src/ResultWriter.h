@@ -0,0 +1,30 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include "Controller.h"
+#include "Timing.h"
+
+enum OutputFormat { textOutput, jsonOutput, csvOutput };
+
+// everything about a run, that the controller does not know
+typedef struct RunInfo {
+	std::string trace;
+	double runtimeSeconds = 0;
+	// phase timing, only filled with --timing
+	bool timing = false;
+	PhaseTime io;
+	PhaseTime parse;
+	PhaseTime simulation;
+	unsigned long long peakRssBytes = 0;
+	unsigned long long cacheBytes = 0;
+	unsigned long long droppedAccesses = 0;	// not simulated because the shared memory ring was full (--shm-drop)
+} RunInfo;
+
+// writes configuration, counters, derived rates and runtime as one record
+// + text: the human readable Controller::printResults
+// + json: one object on a single line
+// + csv: a header line and a value line
+// fields are streamed directly, no intermediate strings are built
+void writeResults(std::ostream& stream, OutputFormat format, Controller& controller, const RunInfo& run);
+// human readable phase timing report
+void writeTimingReport(std::ostream& stream, Controller& controller, const RunInfo& run);
@@ -0,0 +1,94 @@
+#include "ReuseAnalyzer.h"
+#include <algorithm>
+#include <bit>
+
+
+ReuseAnalyzer::ReuseAnalyzer(bool withDistance) : lastAccesses(1 << 16) {
+	this->withDistance = withDistance;
+	if (withDistance) this->fenwick.assign((1 << 16) + 1, 0);
+}
+
+void ReuseAnalyzer::access(unsigned long long block, bool write) {
+	this->time++;
+	if (this->withDistance && this->nextSlot >= this->fenwick.size()) this->compactSlots();
+
+	bool inserted;
+	LastAccess& last = this->lastAccesses.insert(block, inserted);
+	if (inserted) {
+		this->coldAccesses[write]++;
+	}
+	else {
+		this->reuseTime[write][bucket(this->time - last.time)]++;
+		if (this->withDistance) {
+			// every block with its last access after ours was touched in between
+			unsigned long long distance = this->fenwickSum(this->nextSlot - 1) - this->fenwickSum(last.slot);
+			this->reuseDistance[write][bucket(distance)]++;
+			this->fenwickAdd(last.slot, -1);
+		}
+	}
+
+	last.time = this->time;
+	if (this->withDistance) {
+		last.slot = this->nextSlot++;
+		this->fenwickAdd(last.slot, 1);
+	}
+}
+
+void ReuseAnalyzer::writeCsv(std::ostream& stream) const {
+	stream << "bucket,min,max,readReuseTime,writeReuseTime";
+	if (this->withDistance) stream << ",readReuseDistance,writeReuseDistance";
+	stream << '\n';
+
+	stream << "cold,,," << this->coldAccesses[0] << ',' << this->coldAccesses[1];
+	if (this->withDistance) stream << ",,";
+	stream << '\n';
+
+	for (unsigned int b = 0; b < bucketCount; b++) {
+		unsigned long long min = b == 0 ? 0 : 1ULL << (b - 1);
+		unsigned long long max = b == 0 ? 0 : min + (min - 1);
+		stream << b << ',' << min << ',' << max << ',' << this->reuseTime[0][b] << ',' << this->reuseTime[1][b];
+		if (this->withDistance) stream << ',' << this->reuseDistance[0][b] << ',' << this->reuseDistance[1][b];
+		stream << '\n';
+	}
+}
+
+void ReuseAnalyzer::fenwickAdd(unsigned long long slot, int value) {
+	for (; slot < this->fenwick.size(); slot += slot & (~slot + 1)) {
+		this->fenwick[slot] += value;
+	}
+}
+
+unsigned long long ReuseAnalyzer::fenwickSum(unsigned long long slot) const {
+	unsigned long long sum = 0;
+	for (; slot > 0; slot -= slot & (~slot + 1)) {
+		sum += this->fenwick[slot];
+	}
+	return sum;
+}
+
+// renumbers the live slots to 1..n keeping their order, grows the tree if it is more than half full
+void ReuseAnalyzer::compactSlots() {
+	std::vector<LastAccess*> live;
+	live.reserve(this->lastAccesses.size());
+	this->lastAccesses.forEach([&live](unsigned long long, LastAccess& last) { live.push_back(&last); });
+	std::sort(live.begin(), live.end(), [](const LastAccess* a, const LastAccess* b) { return a->slot < b->slot; });
+
+	unsigned long long size = this->fenwick.size() - 1;
+	while (live.size() * 2 > size) size *= 2;
+	this->fenwick.assign(size + 1, 0);
+
+	// build the tree in O(n): set the leaves, then push every node into its parent
+	for (unsigned long long slot = 1; slot <= live.size(); slot++) {
+		live[slot - 1]->slot = slot;
+		this->fenwick[slot] = 1;
+	}
+	for (unsigned long long slot = 1; slot <= size; slot++) {
+		unsigned long long parent = slot + (slot & (~slot + 1));
+		if (parent <= size) this->fenwick[parent] += this->fenwick[slot];
+	}
+	this->nextSlot = live.size() + 1;
+}
+
+unsigned int ReuseAnalyzer::bucket(unsigned long long value) {
+	return std::bit_width(value);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <algorithm>
+#include <ostream>
+#include <vector>
+#include "BlockMap.h"
+
+// log2 bucketed histograms of reuse time and reuse distance, split by read and write
+// + reuse time: accesses since the last access to the same block
+// + reuse distance: unique blocks accessed since the last access to the same block (optional, costs O(log n) per access)
+// bucket 0 counts the value 0, bucket b counts values in [2^(b-1), 2^b)
+class ReuseAnalyzer {
+public:
+	static const unsigned int bucketCount = 65;
+	unsigned long long reuseTime[2][bucketCount] = {};		// [read, write][bucket]
+	unsigned long long reuseDistance[2][bucketCount] = {};	// [read, write][bucket]
+	unsigned long long coldAccesses[2] = {};				// first accesses to a block, no reuse
+
+	ReuseAnalyzer(bool withDistance);
+	// called for every access with the block address (address without offset)
+	void access(unsigned long long block, bool write);
+	void writeCsv(std::ostream& stream) const;
+	bool hasDistance() const { return this->withDistance; }
+	// zeroes the histograms, the last accesses stay, so later reuses are still measured
+	void clearCounters() {
+		std::fill(&this->reuseTime[0][0], &this->reuseTime[0][0] + 2 * bucketCount, 0ULL);
+		std::fill(&this->reuseDistance[0][0], &this->reuseDistance[0][0] + 2 * bucketCount, 0ULL);
+		this->coldAccesses[0] = 0;
+		this->coldAccesses[1] = 0;
+	}
+
+private:
+	typedef struct LastAccess {
+		unsigned long long time;
+		unsigned long long slot;	// position in the fenwick tree, only used for reuse distance
+	} LastAccess;
+
+	bool withDistance = false;
+	unsigned long long time = 0;
+	BlockMap<LastAccess> lastAccesses;
+
+	// fenwick tree over slots, a slot is 1 while it holds the last access of a block
+	// slots are handed out in access order and compacted once all are used
+	std::vector<unsigned int> fenwick;		// 1 based, fenwick[0] is unused
+	unsigned long long nextSlot = 1;
+
+	void fenwickAdd(unsigned long long slot, int value);
+	unsigned long long fenwickSum(unsigned long long slot) const;	// sum of slots [1, slot]
+	void compactSlots();
+	static unsigned int bucket(unsigned long long value);
+};
@@ -0,0 +1,247 @@
+#include "Server.h"
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "cachesim_serve.h"
+
+
+// false once the peer closed the connection
+static bool readFully(int fd, char* buffer, size_t size) {
+	while (size > 0) {
+		ssize_t got = recv(fd, buffer, size, 0);
+		if (got < 0 && errno == EINTR) continue;
+		if (got <= 0) return false;
+		buffer += got;
+		size -= got;
+	}
+	return true;
+}
+
+static bool writeFully(int fd, const char* buffer, size_t size) {
+	while (size > 0) {
+		ssize_t sent = send(fd, buffer, size, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR) continue;
+		if (sent <= 0) return false;
+		buffer += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+static bool reply(int fd, unsigned char type, unsigned char status, const char* payload, size_t length) {
+	cachesim_message_header header = { type, status, CACHESIM_SERVE_VERSION, (uint32_t)length };
+	return writeFully(fd, (const char*)&header, sizeof(header)) && writeFully(fd, payload, length);
+}
+
+static sockaddr_un socketAddress(const std::string& path) {
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		std::string err = std::format("socket path '{}' is longer than {} characters", path, sizeof(address.sun_path) - 1);
+		throw std::invalid_argument(err);
+	}
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	return address;
+}
+
+Server::Server(const std::string& socketPath) {
+	this->socketPath = socketPath;
+	sockaddr_un address = socketAddress(socketPath);
+
+	// a socket file nobody accepts on is left from a server that did not exit cleanly
+	int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+	bool running = probe >= 0 && connect(probe, (sockaddr*)&address, sizeof(address)) == 0;
+	if (probe >= 0) close(probe);
+	if (running) {
+		std::string err = std::format("a server is already listening on '{}'", socketPath);
+		throw std::runtime_error(err);
+	}
+	unlink(socketPath.c_str());
+
+	this->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (this->listenFd < 0 || bind(this->listenFd, (sockaddr*)&address, sizeof(address)) != 0 || listen(this->listenFd, 64) != 0) {
+		std::string err = std::format("Couldn't listen on '{}' ({})", socketPath, std::strerror(errno));
+		if (this->listenFd >= 0) close(this->listenFd);
+		throw std::runtime_error(err);
+	}
+}
+
+Server::~Server() {
+	for (Client& client : this->clients) {
+		shutdown(client.fd, SHUT_RDWR);
+		client.thread.join();
+		close(client.fd);
+	}
+	close(this->listenFd);
+	unlink(this->socketPath.c_str());
+}
+
+void Server::run(const std::atomic<bool>& stop) {
+	pollfd listening = { this->listenFd, POLLIN, 0 };
+	while (!stop.load()) {
+		// finished clients are joined while waiting for new ones
+		for (size_t i = 0; i < this->clients.size();) {
+			if (!this->clients[i].done->load()) {
+				i++;
+				continue;
+			}
+			this->clients[i].thread.join();
+			close(this->clients[i].fd);
+			this->clients[i] = std::move(this->clients.back());
+			this->clients.pop_back();
+		}
+
+		if (poll(&listening, 1, 200) <= 0) continue;
+		int fd = accept4(this->listenFd, 0, 0, SOCK_CLOEXEC);
+		if (fd < 0) continue;
+		Client client;
+		client.fd = fd;
+		client.done = std::make_shared<std::atomic<bool>>(false);
+		std::shared_ptr<std::atomic<bool>> done = client.done;
+		client.thread = std::thread([this, fd, done] {
+			this->serveClient(fd);
+			done->store(true);
+		});
+		this->clients.push_back(std::move(client));
+	}
+}
+
+std::shared_ptr<Server::Instance> Server::openInstance(const std::string& name, const Config& config) {
+	std::lock_guard<std::mutex> lock(this->instancesMutex);
+	std::shared_ptr<Instance>& instance = this->instances[name];
+	if (!instance) {
+		instance = std::make_shared<Instance>();
+		instance->controller = std::make_unique<Controller>(config.cellCount, config.blockSize, config.associativity,
+			config.evictionPolicy, config.writeHitPolicy, config.writeMissPolicy);
+		return instance;
+	}
+	const Config& existing = instance->controller->getConfig();
+	if (existing.cellCount != config.cellCount || existing.blockSize != config.blockSize || existing.associativity != config.associativity
+		|| existing.evictionPolicy != config.evictionPolicy || existing.writeHitPolicy != config.writeHitPolicy || existing.writeMissPolicy != config.writeMissPolicy) {
+		std::string err = std::format("instance '{}' exists with another configuration", name);
+		throw std::invalid_argument(err);
+	}
+	return instance;
+}
+
+void Server::serveClient(int fd) {
+	std::shared_ptr<Instance> instance;
+	std::vector<char> payload;
+	std::vector<Access> batch;
+	cachesim_message_header header;
+
+	while (readFully(fd, (char*)&header, sizeof(header))) {
+		if (header.version != CACHESIM_SERVE_VERSION || header.length > CACHESIM_SERVE_MAX_PAYLOAD) {
+			std::string err = std::format("unsupported protocol version({}) or payload length({})", header.version, header.length);
+			reply(fd, header.type, 1, err.data(), err.size());
+			return;
+		}
+		payload.resize(header.length);
+		if (!readFully(fd, payload.data(), payload.size())) return;
+
+		std::string answer;
+		try {
+			if (header.type == CACHESIM_OPEN) {
+				cachesim_open_request request;
+				if (payload.size() < sizeof(request)) throw std::invalid_argument("open request without configuration");
+				std::memcpy(&request, payload.data(), sizeof(request));
+				cachesim_config& c = request.config;
+				if (c.eviction_policy < CACHESIM_RANDOM || c.eviction_policy > CACHESIM_LRU) throw std::invalid_argument("invalid eviction policy");
+				Config config;
+				config.cellCount = c.cell_count;
+				config.blockSize = c.block_size;
+				config.associativity = c.associativity;
+				config.evictionPolicy = (EvictionPolicy)c.eviction_policy;
+				config.writeHitPolicy = c.write_hit_policy == CACHESIM_WRITE_THROUGH ? writeThrough : writeBack;
+				config.writeMissPolicy = c.write_miss_policy == CACHESIM_NO_ALLOCATE ? noAllocate : allocate;
+				instance = this->openInstance(std::string(payload.data() + sizeof(request), payload.size() - sizeof(request)), config);
+				if (!reply(fd, header.type, 0, 0, 0)) return;
+				continue;
+			}
+			if (!instance) throw std::logic_error("connection is not bound to an instance, send an open request first");
+
+			if (header.type == CACHESIM_ACCESSES) {
+				// unpacked before taking the instance, so clients of one instance only wait for the simulation
+				if (payload.size() % sizeof(unsigned long long) != 0) {
+					std::string err = std::format("accesses payload of {} bytes is not a multiple of 8", payload.size());
+					throw std::invalid_argument(err);
+				}
+				size_t count = payload.size() / sizeof(unsigned long long);
+				batch.resize(count);
+				const char* pos = payload.data();
+				for (size_t i = 0; i < count; i++, pos += sizeof(unsigned long long)) {
+					unsigned long long address;
+					std::memcpy(&address, pos, sizeof(address));
+					batch[i] = { address & ~CACHESIM_SERVE_WRITE, (address & CACHESIM_SERVE_WRITE) ? writeOp : readOp };
+				}
+				std::lock_guard<std::mutex> lock(instance->mutex);
+				instance->controller->simulate(batch);
+				continue;
+			}
+
+			std::string name(payload.data(), payload.size());
+			switch (header.type) {
+			case CACHESIM_STATS: {
+				std::lock_guard<std::mutex> lock(instance->mutex);
+				const Stats& s = instance->controller->getStats();
+				unsigned long long counters[] = { s.hits, s.misses, s.evictions, s.writebacks, s.flushWritebacks, s.cleanEvictions,
+					s.writeThroughs, s.fills, s.fillBytes, s.writebackBytes, s.writeThroughBytes };
+				static_assert(sizeof(counters) == sizeof(cachesim_stats), "the reply is a cachesim_stats");
+				answer.assign((const char*)counters, sizeof(counters));
+				break;
+			}
+			case CACHESIM_RESET: {
+				std::lock_guard<std::mutex> lock(instance->mutex);
+				instance->controller->reset();
+				break;
+			}
+			case CACHESIM_SNAPSHOT: {
+				std::shared_ptr<std::string> state = std::make_shared<std::string>();
+				{
+					std::lock_guard<std::mutex> lock(instance->mutex);
+					instance->controller->saveState(*state);
+				}
+				std::lock_guard<std::mutex> lock(this->snapshotsMutex);
+				this->snapshots[name] = state;
+				break;
+			}
+			case CACHESIM_RESTORE: {
+				std::shared_ptr<const std::string> state;
+				{
+					std::lock_guard<std::mutex> lock(this->snapshotsMutex);
+					auto snapshot = this->snapshots.find(name);
+					if (snapshot == this->snapshots.end()) {
+						std::string err = std::format("there is no snapshot '{}'", name);
+						throw std::invalid_argument(err);
+					}
+					state = snapshot->second;
+				}
+				std::lock_guard<std::mutex> lock(instance->mutex);
+				instance->controller->loadState(state->data(), state->size());
+				break;
+			}
+			case CACHESIM_FLUSH: {
+				std::lock_guard<std::mutex> lock(instance->mutex);
+				instance->controller->flush();
+				break;
+			}
+			default: {
+				std::string err = std::format("unknown request type({})", header.type);
+				throw std::invalid_argument(err);
+			}
+			}
+		}
+		catch (const std::exception& e) {
+			std::string err = e.what();
+			if (!reply(fd, header.type, 1, err.data(), err.size())) return;
+			continue;
+		}
+		if (!reply(fd, header.type, 0, answer.data(), answer.size())) return;
+	}
+}
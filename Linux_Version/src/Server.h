@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Controller.h"
+
+// CacheSim serve: keeps named cache instances resident and simulates batches sent over a Unix domain socket
+// protocol in include/cachesim_serve.h, every client connection is served by its own thread
+// clients bound to the same instance take turns per request, snapshots are shared by all instances
+class Server {
+public:
+	// listens on socketPath, a stale socket file is replaced, a running server is not
+	Server(const std::string& socketPath);
+	~Server();
+	// accepts clients until stop is set, then closes all connections
+	void run(const std::atomic<bool>& stop);
+
+private:
+	typedef struct Instance {
+		std::mutex mutex;
+		std::unique_ptr<Controller> controller;
+	} Instance;
+
+	typedef struct Client {
+		std::thread thread;
+		int fd = -1;
+		std::shared_ptr<std::atomic<bool>> done;
+	} Client;
+
+	std::string socketPath;
+	int listenFd = -1;
+	std::mutex instancesMutex;
+	std::map<std::string, std::shared_ptr<Instance>> instances;
+	std::mutex snapshotsMutex;
+	std::map<std::string, std::shared_ptr<const std::string>> snapshots;
+	std::vector<Client> clients;
+
+	void serveClient(int fd);
+	std::shared_ptr<Instance> openInstance(const std::string& name, const Config& config);
+};
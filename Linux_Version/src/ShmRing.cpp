@@ -0,0 +1,97 @@
+#include "ShmRing.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "SpscQueue.h"
+
+static_assert(sizeof(cachesim_shm_ring) == 192, "cachesim_shm_ring is three cache lines");
+static_assert(sizeof(cachesim_shm_record) == sizeof(Access), "records are simulated in place as Access");
+static_assert(offsetof(cachesim_shm_record, op) == offsetof(Access, op), "records are simulated in place as Access");
+
+
+ShmRing::ShmRing(const std::string& name, unsigned long long capacity, bool dropWhenFull) {
+	this->name = name[0] == '/' ? name : "/" + name;
+	unsigned long long records = 1;
+	while (records < capacity) records *= 2;
+	this->mapped = sizeof(cachesim_shm_ring) + records * sizeof(cachesim_shm_record);
+
+	// a ring left by a crashed run is not reused, another CacheSim might still consume it
+	int fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0) {
+		std::string err = std::format("Couldn't create shared memory '{}' ({}), remove /dev/shm{} if it is left from an old run", this->name, std::strerror(errno), this->name);
+		throw std::runtime_error(err);
+	}
+	void* mapping = MAP_FAILED;
+	if (ftruncate(fd, this->mapped) == 0) {
+		mapping = mmap(0, this->mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		shm_unlink(this->name.c_str());
+		std::string err = std::format("Couldn't map {} bytes of shared memory '{}'", this->mapped, this->name);
+		throw std::runtime_error(err);
+	}
+
+	// the pages are zero, the magic number makes the ring visible to the producer
+	this->ring = (cachesim_shm_ring*)mapping;
+	this->records = (const Access*)(this->ring + 1);
+	this->ring->version = CACHESIM_SHM_VERSION;
+	this->ring->flags = dropWhenFull ? CACHESIM_SHM_DROP : 0;
+	this->ring->capacity = records;
+	__atomic_store_n(&this->ring->magic, CACHESIM_SHM_MAGIC, __ATOMIC_RELEASE);
+}
+
+ShmRing::~ShmRing() {
+	munmap(this->ring, this->mapped);
+	shm_unlink(this->name.c_str());
+}
+
+void ShmRing::consume(Controller& controller, PhaseTime& simulation) {
+	// at most this many records before the consumed count is published, so a waiting producer gets space back soon
+	const unsigned long long maxSpan = 1 << 16;
+	unsigned long long mask = this->ring->capacity - 1;
+	unsigned long long tail = __atomic_load_n(&this->ring->tail, __ATOMIC_RELAXED);
+	PhaseTimer timer;
+	unsigned int waits = 0;
+
+	while (true) {
+		unsigned long long head = __atomic_load_n(&this->ring->head, __ATOMIC_ACQUIRE);
+		if (head == tail) {
+			// closed is set after the last head, head has to be read again
+			if (__atomic_load_n(&this->ring->closed, __ATOMIC_ACQUIRE)) {
+				if (__atomic_load_n(&this->ring->head, __ATOMIC_ACQUIRE) == tail) return;
+				continue;
+			}
+			// a producer that died never detaches, checked about every 50ms once idle
+			if (waits >= 1024 && waits % 1024 == 0 && this->producerDied()) return;
+			backOff(waits);
+			continue;
+		}
+		waits = 0;
+
+		// [tail, head) in place, split where the ring wraps
+		unsigned long long first = tail & mask;
+		unsigned long long count = std::min({ head - tail, this->ring->capacity - first, maxSpan });
+		timer.start();
+		controller.simulate(std::span<const Access>(this->records + first, count));
+		timer.stop(simulation);
+		tail += count;
+		__atomic_store_n(&this->ring->tail, tail, __ATOMIC_RELEASE);
+	}
+}
+
+unsigned long long ShmRing::dropped() const {
+	return __atomic_load_n(&this->ring->dropped, __ATOMIC_RELAXED);
+}
+
+bool ShmRing::producerDied() const {
+	pid_t pid = __atomic_load_n(&this->ring->producer_pid, __ATOMIC_ACQUIRE);
+	return pid != 0 && kill(pid, 0) != 0 && errno == ESRCH;
+}
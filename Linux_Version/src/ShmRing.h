@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include "Controller.h"
+#include "Timing.h"
+#include "cachesim_shm.h"
+
+// consumer side of a POSIX shared memory ring of accesses, written by a live process through cachesim_shm.h
+// the ring is created here and removed again by the destructor, the producer attaches to it by name
+class ShmRing {
+public:
+	// capacity: records, rounded up to a power of 2
+	// dropWhenFull: the producer drops (and counts) records instead of waiting for free space
+	ShmRing(const std::string& name, unsigned long long capacity, bool dropWhenFull);
+	~ShmRing();
+	// simulates records in place as they are published, returns once the producer detached (or died) and the ring is empty
+	// never blocks the producer: the only shared writes are the consumed count and the ring is never locked
+	void consume(Controller& controller, PhaseTime& simulation);
+	// records the producer dropped because the ring was full
+	unsigned long long dropped() const;
+	const std::string& getName() const { return this->name; }
+
+private:
+	std::string name;
+	cachesim_shm_ring* ring = 0;
+	const Access* records = 0;
+	size_t mapped = 0;
+
+	bool producerDied() const;
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// waits for another thread: spin first, then give the core away, sleep if the other side is slow (e.g. waiting for a pipe)
+inline void backOff(unsigned int& waits) {
+	waits++;
+	if (waits < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}
+	else if (waits < 1024) {
+		std::this_thread::yield();
+	}
+	else {
+		std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+}
+
+// bounded lock free ring for exactly one producer and one consumer thread
+// push() waits while the ring is full (back-pressure), pop() waits while it is empty
+// close() ends the queue: push() fails, pop() fails once the ring is empty
+template <typename T>
+class SpscQueue {
+public:
+	SpscQueue(size_t capacity) {
+		size_t size = 1;
+		while (size < capacity) size *= 2;
+		this->slots.resize(size);
+		this->mask = size - 1;
+	}
+
+	// return false if the queue was closed
+	bool push(T value) {
+		size_t tail = this->tail.load(std::memory_order_relaxed);
+		unsigned int waits = 0;
+		while (tail - this->cachedHead > this->mask) {
+			if (this->closed.load(std::memory_order_acquire)) return false;
+			this->cachedHead = this->head.load(std::memory_order_acquire);
+			if (tail - this->cachedHead > this->mask) backOff(waits);
+		}
+		this->slots[tail & this->mask] = std::move(value);
+		this->tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// return false if the queue was closed and is empty
+	bool pop(T& value) {
+		size_t head = this->head.load(std::memory_order_relaxed);
+		unsigned int waits = 0;
+		while (head == this->cachedTail) {
+			this->cachedTail = this->tail.load(std::memory_order_acquire);
+			if (head != this->cachedTail) break;
+			if (this->closed.load(std::memory_order_acquire)) {
+				// elements pushed right before close
+				this->cachedTail = this->tail.load(std::memory_order_acquire);
+				if (head == this->cachedTail) return false;
+				break;
+			}
+			backOff(waits);
+		}
+		value = std::move(this->slots[head & this->mask]);
+		this->head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	void close() {
+		this->closed.store(true, std::memory_order_release);
+	}
+
+private:
+	std::vector<T> slots;
+	size_t mask = 0;
+	// producer and consumer indices on their own cache lines, so they do not bounce between cores
+	alignas(64) std::atomic<size_t> head { 0 };		// next slot to pop, written by the consumer
+	size_t cachedTail = 0;								// consumer's copy of tail
+	alignas(64) std::atomic<size_t> tail { 0 };		// next slot to push, written by the producer
+	size_t cachedHead = 0;								// producer's copy of head
+	alignas(64) std::atomic<bool> closed { false };
+};
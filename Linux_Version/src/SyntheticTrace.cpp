@@ -0,0 +1,202 @@
+#include "SyntheticTrace.h"
+#include <cmath>
+#include <format>
+#include <stdexcept>
+
+
+FastRandom::FastRandom(unsigned long long seed) {
+	// seed the state with splitmix64
+	for (int i = 0; i < 4; i++) {
+		seed += 0x9E3779B97F4A7C15ULL;
+		unsigned long long z = seed;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		this->s[i] = z ^ (z >> 31);
+	}
+}
+
+SyntheticTrace::SyntheticTrace(const StreamConfig& config) : random(config.seed) {
+	this->config = config;
+	this->elementSize = config.stride;
+	if (config.kind == sequentialStream) this->elementSize = 4;
+	if (config.kind == stencilStream || config.kind == matrixStream) this->elementSize = 8;
+	if (this->elementSize == 0) throw std::logic_error("stride must be bigger than 0");
+	this->elements = config.footprint / this->elementSize;
+	if (this->elements == 0) throw std::logic_error(std::format("footprint({}) smaller than one element({})", config.footprint, this->elementSize));
+	if (config.writeRatio >= 1.0) this->writeThreshold = ~0ULL;
+	else if (config.writeRatio > 0.0) this->writeThreshold = (unsigned long long)std::ldexp(config.writeRatio, 64);
+
+	if (config.kind == pointerChaseStream) {
+		if (this->elements > 0xFFFFFFFFULL) throw std::logic_error("pointer chase footprint too big");
+		// sattolo's algorithm gives a random permutation that is a single cycle over all elements
+		std::vector<unsigned int> order(this->elements);
+		for (unsigned long long i = 0; i < this->elements; i++) order[i] = i;
+		for (unsigned long long i = this->elements - 1; i > 0; i--) {
+			std::swap(order[i], order[this->random.below(i)]);
+		}
+		this->chase.resize(this->elements);
+		for (unsigned long long i = 0; i < this->elements; i++) {
+			this->chase[order[i]] = order[(i + 1) % this->elements];
+		}
+	}
+
+	if (config.kind == stencilStream || config.kind == matrixStream) {
+		// stencil has 2 arrays, matrix 3
+		unsigned long long arrays = config.kind == stencilStream ? 2 : 3;
+		this->n = (unsigned long long)std::sqrt((double)this->elements / arrays);
+		if (this->n < 3) throw std::logic_error(std::format("footprint({}) too small for a {} sweep", config.footprint, kindName(config.kind)));
+		if (config.kind == stencilStream) this->i = this->j = 1;
+	}
+
+	if (config.kind == zipfStream) {
+		if (config.zipfS <= 0) throw std::logic_error("zipf s must be bigger than 0");
+		this->zipfHx0 = this->zipfH(1.5) - 1.0;
+		this->zipfHn = this->zipfH(this->elements + 0.5);
+		this->zipfSkip = 2.0 - this->zipfHInverse(this->zipfH(2.5) - std::pow(2.0, -config.zipfS));
+	}
+}
+
+void SyntheticTrace::generate(std::vector<Access>& batch, size_t count) {
+	size_t first = batch.size();
+	batch.resize(first + count);
+	Access* out = batch.data() + first;
+	unsigned long long base = this->config.base;
+	unsigned long long elementSize = this->elementSize;
+
+	for (size_t i = 0; i < count; i++) {
+		unsigned long long element;
+		switch (this->config.kind)
+		{
+		case stencilStream:
+			this->nextStencil(out[i]);
+			continue;
+		case matrixStream:
+			this->nextMatrix(out[i]);
+			continue;
+		case sequentialStream:
+		case stridedStream:
+			element = this->position;
+			if (++this->position == this->elements) this->position = 0;
+			break;
+		case randomStream:
+			element = this->random.below(this->elements);
+			break;
+		case zipfStream:
+			element = this->nextZipf() - 1;
+			break;
+		case pointerChaseStream:
+			element = this->position;
+			this->position = this->chase[element];
+			break;
+		default:
+			throw std::invalid_argument("No valid stream present");
+		}
+		out[i].address = base + element * elementSize;
+		out[i].op = this->writeThreshold != 0 && this->random.next() < this->writeThreshold ? writeOp : readOp;
+	}
+}
+
+StreamKind SyntheticTrace::parseKind(const std::string& name) {
+	if (name == "sequential") return sequentialStream;
+	if (name == "strided") return stridedStream;
+	if (name == "random") return randomStream;
+	if (name == "zipf") return zipfStream;
+	if (name == "chase") return pointerChaseStream;
+	if (name == "stencil") return stencilStream;
+	if (name == "matrix") return matrixStream;
+	std::string err = std::format("stream must be [sequential|strided|random|zipf|chase|stencil|matrix] and not '{}'", name);
+	throw std::invalid_argument(err);
+}
+
+std::string SyntheticTrace::kindName(StreamKind kind) {
+	switch (kind) {
+	case sequentialStream: return "sequential";
+	case stridedStream: return "strided";
+	case randomStream: return "random";
+	case zipfStream: return "zipf";
+	case pointerChaseStream: return "chase";
+	case stencilStream: return "stencil";
+	case matrixStream: return "matrix";
+	}
+	return "";
+}
+
+// k walks center, north, south, west, east (reads of in), then the write of out
+void SyntheticTrace::nextStencil(Access& access) {
+	static const long long rowOffset[5] = { 0, -1, 1, 0, 0 };
+	static const long long colOffset[5] = { 0, 0, 0, -1, 1 };
+	unsigned long long in = this->config.base;
+	unsigned long long out = in + this->n * this->n * 8;
+
+	if (this->k < 5) {
+		unsigned long long row = this->i + rowOffset[this->k];
+		unsigned long long col = this->j + colOffset[this->k];
+		access.address = in + (row * this->n + col) * 8;
+		access.op = readOp;
+		this->k++;
+		return;
+	}
+	access.address = out + (this->i * this->n + this->j) * 8;
+	access.op = writeOp;
+
+	// next inner grid point, borders are only read
+	this->k = 0;
+	if (++this->j == this->n - 1) {
+		this->j = 1;
+		if (++this->i == this->n - 1) this->i = 1;
+	}
+}
+
+// every k step reads a[i][k] and b[k][j], after the k loop c[i][j] is written
+void SyntheticTrace::nextMatrix(Access& access) {
+	unsigned long long a = this->config.base;
+	unsigned long long b = a + this->n * this->n * 8;
+	unsigned long long c = b + this->n * this->n * 8;
+	unsigned long long step = this->k / 2;
+
+	if (step < this->n) {
+		if (this->k % 2 == 0) access.address = a + (this->i * this->n + step) * 8;
+		else access.address = b + (step * this->n + this->j) * 8;
+		access.op = readOp;
+		this->k++;
+		return;
+	}
+	access.address = c + (this->i * this->n + this->j) * 8;
+	access.op = writeOp;
+
+	this->k = 0;
+	if (++this->j == this->n) {
+		this->j = 0;
+		if (++this->i == this->n) this->i = 0;
+	}
+}
+
+// integral of the zipf density x^-s
+double SyntheticTrace::zipfH(double x) const {
+	double s = this->config.zipfS;
+	double logX = std::log(x);
+	if (std::abs(1.0 - s) < 1e-8) return logX;
+	return std::expm1((1.0 - s) * logX) / (1.0 - s);
+}
+
+double SyntheticTrace::zipfHInverse(double x) const {
+	double s = this->config.zipfS;
+	if (std::abs(1.0 - s) < 1e-8) return std::exp(x);
+	double t = x * (1.0 - s);
+	if (t < -1.0) t = -1.0;		// rounding errors close to the lower bound
+	return std::exp(std::log1p(t) / (1.0 - s));
+}
+
+// returns a rank in [1, elements]
+unsigned long long SyntheticTrace::nextZipf() {
+	while (true) {
+		double u = this->zipfHn + this->random.uniform() * (this->zipfHx0 - this->zipfHn);
+		double x = this->zipfHInverse(u);
+		double k = std::floor(x + 0.5);
+		if (k < 1) k = 1;
+		else if (k > this->elements) k = this->elements;
+		if (k - x <= this->zipfSkip || u >= this->zipfH(k + 0.5) - std::pow(k, -this->config.zipfS)) {
+			return (unsigned long long)k;
+		}
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Access.h"
+
+enum StreamKind { sequentialStream, stridedStream, randomStream, zipfStream, pointerChaseStream, stencilStream, matrixStream };
+
+typedef struct StreamConfig {
+	StreamKind kind = sequentialStream;
+	unsigned long long base = 0;				// first address
+	unsigned long long footprint = 1 << 24;		// bytes covered by the stream
+	unsigned int stride = 64;					// bytes between elements (sequential streams use 4 byte words)
+	double zipfS = 1.0;							// zipf skew, element k is accessed with probability ~ 1/k^s
+	double writeRatio = 0.0;					// share of writes (stencil and matrix write their results instead)
+	unsigned long long seed = 1;
+} StreamConfig;
+
+// xoshiro256**, fast enough to outrun the simulator by far
+class FastRandom {
+public:
+	FastRandom(unsigned long long seed = 1);
+	unsigned long long next() {
+		unsigned long long result = rotl(this->s[1] * 5, 7) * 9;
+		unsigned long long t = this->s[1] << 17;
+		this->s[2] ^= this->s[0];
+		this->s[3] ^= this->s[1];
+		this->s[1] ^= this->s[2];
+		this->s[0] ^= this->s[3];
+		this->s[2] ^= t;
+		this->s[3] = rotl(this->s[3], 45);
+		return result;
+	}
+	// uniform in [0, bound)
+	unsigned long long below(unsigned long long bound) {
+		return (unsigned long long)(((unsigned __int128)this->next() * bound) >> 64);
+	}
+	// uniform in [0, 1)
+	double uniform() {
+		return (this->next() >> 11) * 0x1.0p-53;
+	}
+
+private:
+	unsigned long long s[4];
+	static unsigned long long rotl(unsigned long long x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+};
+
+// generates synthetic access streams in batches, without touching disk
+// + sequential: 4 byte words, strided: one element every stride bytes, both wrap around at footprint
+// + random: uniform elements, zipf: skewed elements, chase: follows a random single cycle through all elements
+// + stencil, matrix: loop nests over 8 byte elements, footprint is split between their arrays
+class SyntheticTrace {
+public:
+	SyntheticTrace(const StreamConfig& config);
+	// appends count accesses to batch
+	void generate(std::vector<Access>& batch, size_t count);
+
+	static StreamKind parseKind(const std::string& name);
+	static std::string kindName(StreamKind kind);
+
+private:
+	StreamConfig config;
+	FastRandom random;
+	unsigned long long elements = 0;		// footprint / element size
+	unsigned long long elementSize = 0;
+	unsigned long long position = 0;		// element index of sequential, strided and pointer chase streams
+	unsigned long long writeThreshold = 0;	// next() below this is a write
+	std::vector<unsigned int> chase;		// pointer chase: next element of every element, one single cycle
+
+	// stencil: 5 point jacobi sweep over an n x n grid, reads in[i][j] and its neighbours, writes out[i][j]
+	// matrix: naive ijk multiplication of n x n matrices, reads a[i][k] and b[k][j], writes c[i][j] after every k loop
+	unsigned long long n = 0;
+	unsigned long long i = 0;
+	unsigned long long j = 0;
+	unsigned long long k = 0;
+	void nextStencil(Access& access);
+	void nextMatrix(Access& access);
+
+	// zipf sampling by rejection inversion (Hoermann, Derflinger), O(1) per sample
+	double zipfHx0 = 0;
+	double zipfHn = 0;
+	double zipfSkip = 0;
+	double zipfH(double x) const;
+	double zipfHInverse(double x) const;
+	unsigned long long nextZipf();
+};
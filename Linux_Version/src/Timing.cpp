@@ -0,0 +1,26 @@
+#include "Timing.h"
+#include <sys/resource.h>
+#include <time.h>
+
+
+void PhaseTimer::start() {
+	this->wallStart = std::chrono::steady_clock::now();
+	this->cpuStart = threadCpuSeconds();
+}
+
+void PhaseTimer::stop(PhaseTime& phase) {
+	phase.wallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - this->wallStart).count();
+	phase.cpuSeconds += threadCpuSeconds() - this->cpuStart;
+}
+
+double threadCpuSeconds() {
+	timespec time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+unsigned long long peakRssBytes() {
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (unsigned long long)usage.ru_maxrss * 1024;	// linux reports kilobytes
+}
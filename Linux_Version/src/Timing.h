@@ -0,0 +1,25 @@
+#pragma once
+#include <chrono>
+
+// wall and cpu time spent in one phase of a run
+typedef struct PhaseTime {
+	double wallSeconds = 0;
+	double cpuSeconds = 0;
+} PhaseTime;
+
+// measures phases, call start() and stop() at phase boundaries only
+class PhaseTimer {
+public:
+	void start();
+	// adds the time since start() to phase
+	void stop(PhaseTime& phase);
+
+private:
+	std::chrono::steady_clock::time_point wallStart;
+	double cpuStart = 0;
+};
+
+// cpu time of the calling thread
+double threadCpuSeconds();
+// peak resident set size of the process
+unsigned long long peakRssBytes();
@@ -0,0 +1,82 @@
+#include "Tlb.h"
+#include <format>
+#include <stdexcept>
+#include "helper.h"
+
+
+Tlb::Tlb(const TlbConfig& config) {
+	this->config = config;
+	switch (config.pageSize) {
+	case 1ULL << 12: this->walkLevels = 4; break;
+	case 1ULL << 21: this->walkLevels = 3; break;
+	case 1ULL << 30: this->walkLevels = 2; break;
+	default: {
+		std::string err = std::format("pageSize({}) is not 4K, 2M or 1G", config.pageSize);
+		throw std::invalid_argument(err);
+	}
+	}
+	this->pageBits = log2i(config.pageSize);
+	this->dtlb = makeLevel("dtlb", config.dtlbEntries, config.dtlbWays, config.evictionPolicy);
+	this->stlb = makeLevel("stlb", config.stlbEntries, config.stlbWays, config.evictionPolicy);
+	if (config.pwcEntries > 0) this->pwc = makeLevel("pwc", config.pwcEntries, config.pwcEntries, config.evictionPolicy);
+}
+
+Tlb::~Tlb() {
+	delete this->dtlb.cache;
+	delete this->stlb.cache;
+	delete this->pwc.cache;
+}
+
+Tlb::TlbLevel Tlb::makeLevel(const char* name, unsigned int entries, unsigned int ways, EvictionPolicy evictionPolicy) {
+	if (ways == 0 || ways > entries || entries % ways != 0 || !isOfBase2(entries / ways)) {
+		std::string err = std::format("{} of {} entries and {} ways has no power of 2 set count", name, entries, ways);
+		throw std::logic_error(err);
+	}
+	TlbLevel level;
+	level.cache = new Cache(entries / ways, ways, evictionPolicy);
+	level.indexBits = log2i(entries / ways);
+	return level;
+}
+
+bool Tlb::lookup(TlbLevel& level, unsigned long long key) {
+	unsigned int index = key & ((1ULL << level.indexBits) - 1);
+	unsigned long long tag = key >> level.indexBits;
+	if (level.cache->get(tag, index, 0)) return true;
+	if (level.cache->isFull(index)) {
+		level.cache->evict(tag, index, 0, false);
+	}
+	else {
+		level.cache->set(tag, index, 0, false, true);
+	}
+	return false;
+}
+
+void Tlb::access(unsigned long long address) {
+	unsigned long long page = address >> this->pageBits;
+	if (lookup(this->dtlb, page)) return;
+	this->dtlbMisses++;
+	if (lookup(this->stlb, page)) return;
+	this->stlbMisses++;
+
+	// PAGE WALK, a table level holds 512 entries
+	if (this->pwc.cache && lookup(this->pwc, page >> 9)) {
+		this->pwcHits++;
+		this->walkReferences++;
+		return;
+	}
+	this->walkReferences += this->walkLevels;
+}
+
+std::string Tlb::to_string() const {
+	const char* pageSize = this->config.pageSize == 1ULL << 12 ? "4K" : this->config.pageSize == 1ULL << 21 ? "2M" : "1G";
+	return std::format("{} pages, dtlb {}x{}, stlb {}x{}, page walk cache {}", pageSize, this->config.dtlbEntries / this->config.dtlbWays, this->config.dtlbWays,
+		this->config.stlbEntries / this->config.stlbWays, this->config.stlbWays, this->config.pwcEntries);
+}
+
+unsigned long long Tlb::parsePageSize(const std::string& name) {
+	if (name == "4K") return 1ULL << 12;
+	if (name == "2M") return 1ULL << 21;
+	if (name == "1G") return 1ULL << 30;
+	std::string err = std::format("page size({}) is not 4K, 2M or 1G", name);
+	throw std::invalid_argument(err);
+}
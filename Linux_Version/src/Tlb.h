@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include "Cache.h"
+
+typedef struct TlbConfig {
+	unsigned long long pageSize = 4096;	// 4K, 2M or 1G, one page size for the whole trace
+	unsigned int dtlbEntries = 64;
+	unsigned int dtlbWays = 4;
+	unsigned int stlbEntries = 1536;
+	unsigned int stlbWays = 12;
+	unsigned int pwcEntries = 0;		// page walk cache, 0: none
+	EvictionPolicy evictionPolicy = LRU;
+} TlbConfig;
+
+// two level TLB (L1 DTLB, STLB) on the Cache engine, every level is a Cache of page numbers
+// + dtlb miss, stlb hit: the translation is copied into the dtlb
+// + stlb miss: page walk through the x86-64 radix table, one memory reference per level
+//   (4 for 4K pages, 3 for 2M, 2 for 1G), the translation goes into both levels
+// the page walk cache holds the entries of the level above the leaf, a hit leaves only the leaf reference
+class Tlb {
+public:
+	unsigned long long dtlbMisses = 0;
+	unsigned long long stlbMisses = 0;		// page walks
+	unsigned long long walkReferences = 0;	// memory references of the page walks
+	unsigned long long pwcHits = 0;
+
+	Tlb(const TlbConfig& config);
+	~Tlb();
+	// translates the page of address, called for every access next to the data cache
+	void access(unsigned long long address);
+	const TlbConfig& getConfig() const { return this->config; }
+	std::string to_string() const;
+	// zeroes the counters, the TLB contents stay
+	void clearCounters() {
+		this->dtlbMisses = 0;
+		this->stlbMisses = 0;
+		this->walkReferences = 0;
+		this->pwcHits = 0;
+	}
+	// 4K|2M|1G
+	static unsigned long long parsePageSize(const std::string& name);
+
+private:
+	// a level of the TLB, the key is split into index and tag like an address without offset
+	typedef struct TlbLevel {
+		Cache* cache = 0;
+		int indexBits = 0;
+	} TlbLevel;
+
+	TlbConfig config;
+	int pageBits = 0;
+	unsigned int walkLevels = 0;
+	TlbLevel dtlb;
+	TlbLevel stlb;
+	TlbLevel pwc;
+
+	static TlbLevel makeLevel(const char* name, unsigned int entries, unsigned int ways, EvictionPolicy evictionPolicy);
+	// return true if key was cached, else it is inserted
+	static bool lookup(TlbLevel& level, unsigned long long key);
+};
@@ -0,0 +1,338 @@
+#include "TraceInput.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <format>
+#include <stdexcept>
+#include <unistd.h>
+#ifdef CACHESIM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CACHESIM_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef CACHESIM_HAVE_LZMA
+#include <lzma.h>
+#endif
+
+
+FileInput::FileInput(const std::string& path) {
+	// "-" is stdin, fifos are opened like files (blocks until a writer opens the fifo)
+	if (path == "-") {
+		this->fd = STDIN_FILENO;
+		this->ownsFd = false;
+	}
+	else {
+		this->fd = open(path.c_str(), O_RDONLY);
+	}
+	if (this->fd < 0) {
+		std::string err = std::format("Couldn't open file '{}'. Check if it exists and the path to the file is correct.", path);
+		throw std::runtime_error(err);
+	}
+
+	struct stat status;
+	if (fstat(this->fd, &status) == 0 && !S_ISREG(status.st_mode)) {
+		this->stream = true;
+		// bigger pipe buffer, so the writer blocks less often (may fail, e.g. above /proc/sys/fs/pipe-max-size)
+		if (S_ISFIFO(status.st_mode)) fcntl(this->fd, F_SETPIPE_SZ, 1 << 20);
+	}
+	else {
+		posix_fadvise(this->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+}
+
+FileInput::~FileInput() {
+	if (this->fd >= 0 && this->ownsFd) close(this->fd);
+}
+
+size_t FileInput::read(char* buffer, size_t size) {
+	// bytes returned by peek() come first, the rest of the buffer is read behind them,
+	// so the first chunk holds whole lines for the format detection
+	size_t total = 0;
+	if (this->peekedPos < this->peeked.size()) {
+		total = std::min(size, this->peeked.size() - this->peekedPos);
+		std::memcpy(buffer, this->peeked.data() + this->peekedPos, total);
+		this->peekedPos += total;
+		if (total == size) return total;
+	}
+
+	if (!this->stream) return total + this->readFile(buffer + total, size - total);
+
+	// pipes return at most their buffer per read, collect reads to hand out large chunks
+	while (total < size) {
+		size_t count = this->readFile(buffer + total, size - total);
+		if (count == 0) break;
+		total += count;
+	}
+	return total;
+}
+
+size_t FileInput::peek(unsigned char* buffer, size_t size) {
+	// pipes return short reads, read until size bytes are there or the input ends
+	std::vector<char> bytes(size);
+	size_t total = 0;
+	while (total < size) {
+		size_t count = this->readFile(bytes.data() + total, size - total);
+		if (count == 0) break;
+		total += count;
+	}
+	bytes.resize(total);
+	std::memcpy(buffer, bytes.data(), total);
+	this->peeked.insert(this->peeked.end(), bytes.begin(), bytes.end());
+	return total;
+}
+
+size_t FileInput::readFile(char* buffer, size_t size) {
+	while (true) {
+		ssize_t count = ::read(this->fd, buffer, size);
+		if (count >= 0) return count;
+		if (errno != EINTR) throw std::runtime_error(std::format("Couldn't read trace: {}", std::strerror(errno)));
+	}
+}
+
+#ifdef CACHESIM_HAVE_ZLIB
+class GzipDecoder : public Decoder {
+public:
+	GzipDecoder() {
+		// 15 + 32: maximal window, detect gzip or zlib header
+		if (inflateInit2(&this->stream, 15 + 32) != Z_OK) throw std::runtime_error("Couldn't initialize zlib");
+	}
+	~GzipDecoder() {
+		inflateEnd(&this->stream);
+	}
+	bool decode(const char*& in, const char* inEnd, char*& out, char* outEnd, bool inputEnded) override {
+		// concatenated gzip members are one trace
+		if (this->memberEnded) {
+			if (in == inEnd) return inputEnded;
+			inflateReset(&this->stream);
+			this->memberEnded = false;
+		}
+		this->stream.next_in = (Bytef*)in;
+		this->stream.avail_in = inEnd - in;
+		this->stream.next_out = (Bytef*)out;
+		this->stream.avail_out = outEnd - out;
+		int res = inflate(&this->stream, Z_NO_FLUSH);
+		in = (const char*)this->stream.next_in;
+		out = (char*)this->stream.next_out;
+		if (res == Z_STREAM_END) {
+			this->memberEnded = true;
+			return in == inEnd && inputEnded;
+		}
+		if (res != Z_OK && res != Z_BUF_ERROR) throw std::runtime_error(std::format("gzip trace is corrupt ({})", res));
+		return false;
+	}
+
+private:
+	z_stream stream = {};
+	bool memberEnded = false;
+};
+#endif
+
+#ifdef CACHESIM_HAVE_ZSTD
+class ZstdDecoder : public Decoder {
+public:
+	ZstdDecoder() {
+		this->stream = ZSTD_createDStream();
+		if (!this->stream) throw std::runtime_error("Couldn't initialize zstd");
+	}
+	~ZstdDecoder() {
+		ZSTD_freeDStream(this->stream);
+	}
+	bool decode(const char*& in, const char* inEnd, char*& out, char* outEnd, bool inputEnded) override {
+		// concatenated frames are one trace
+		if (this->frameEnded) {
+			if (in == inEnd) return inputEnded;
+			this->frameEnded = false;
+		}
+		ZSTD_inBuffer input = { in, (size_t)(inEnd - in), 0 };
+		ZSTD_outBuffer output = { out, (size_t)(outEnd - out), 0 };
+		size_t res = ZSTD_decompressStream(this->stream, &output, &input);
+		if (ZSTD_isError(res)) throw std::runtime_error(std::format("zstd trace is corrupt ({})", ZSTD_getErrorName(res)));
+		in += input.pos;
+		out += output.pos;
+		// 0: a frame has ended and is completely flushed
+		if (res == 0) {
+			this->frameEnded = true;
+			return in == inEnd && inputEnded;
+		}
+		return false;
+	}
+
+private:
+	ZSTD_DStream* stream = 0;
+	bool frameEnded = false;
+};
+#endif
+
+#ifdef CACHESIM_HAVE_LZMA
+class XzDecoder : public Decoder {
+public:
+	XzDecoder() {
+		if (lzma_stream_decoder(&this->stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) throw std::runtime_error("Couldn't initialize liblzma");
+	}
+	~XzDecoder() {
+		lzma_end(&this->stream);
+	}
+	bool decode(const char*& in, const char* inEnd, char*& out, char* outEnd, bool inputEnded) override {
+		this->stream.next_in = (const uint8_t*)in;
+		this->stream.avail_in = inEnd - in;
+		this->stream.next_out = (uint8_t*)out;
+		this->stream.avail_out = outEnd - out;
+		lzma_ret res = lzma_code(&this->stream, inputEnded ? LZMA_FINISH : LZMA_RUN);
+		in = (const char*)this->stream.next_in;
+		out = (char*)this->stream.next_out;
+		if (res == LZMA_STREAM_END) return true;
+		if (res != LZMA_OK && res != LZMA_BUF_ERROR) throw std::runtime_error(std::format("xz trace is corrupt ({})", (int)res));
+		return false;
+	}
+
+private:
+	lzma_stream stream = LZMA_STREAM_INIT;
+};
+#endif
+
+static std::unique_ptr<Decoder> createDecoder(Compression compression) {
+	switch (compression) {
+#ifdef CACHESIM_HAVE_ZLIB
+	case gzipCompression: return std::make_unique<GzipDecoder>();
+#endif
+#ifdef CACHESIM_HAVE_ZSTD
+	case zstdCompression: return std::make_unique<ZstdDecoder>();
+#endif
+#ifdef CACHESIM_HAVE_LZMA
+	case xzCompression: return std::make_unique<XzDecoder>();
+#endif
+	default:
+		break;
+	}
+	const char* names[] = { "plain", "gzip", "zstd", "xz" };
+	throw std::runtime_error(std::format("trace is {} compressed, but CacheSim was built without {} support", names[compression], names[compression]));
+}
+
+DecompressingInput::DecompressingInput(std::unique_ptr<TraceInput> source, Compression compression) {
+	this->source = std::move(source);
+	this->decoder = createDecoder(compression);
+	for (Buffer& buffer : this->buffers) {
+		buffer.data.resize(bufferSize);
+		this->freeBuffers.push(&buffer);
+	}
+	this->worker = std::thread(&DecompressingInput::decompressLoop, this);
+}
+
+DecompressingInput::~DecompressingInput() {
+	this->freeBuffers.close();
+	this->filledBuffers.close();
+	this->worker.join();
+}
+
+size_t DecompressingInput::read(char* buffer, size_t size) {
+	if (!this->current) {
+		if (!this->filledBuffers.pop(this->current)) {
+			if (this->error) std::rethrow_exception(this->error);
+			return 0;
+		}
+		this->readPos = 0;
+	}
+
+	// copy from the oldest filled buffer, the decompressor keeps writing the others meanwhile
+	size_t count = std::min(size, this->current->size - this->readPos);
+	std::memcpy(buffer, this->current->data.data() + this->readPos, count);
+	this->readPos += count;
+	if (this->readPos == this->current->size) {
+		this->freeBuffers.push(this->current);
+		this->current = 0;
+	}
+	return count;
+}
+
+void DecompressingInput::decompressLoop() {
+	try {
+		std::vector<char> input(bufferSize);
+		const char* in = input.data();
+		const char* inEnd = input.data();
+		bool inputEnded = false;
+		bool streamEnded = false;
+		Buffer* buffer;
+
+		while (!streamEnded && this->freeBuffers.pop(buffer)) {
+			char* out = buffer->data.data();
+			char* outEnd = out + bufferSize;
+			while (out < outEnd && !streamEnded) {
+				if (in == inEnd && !inputEnded) {
+					size_t count = this->source->read(input.data(), input.size());
+					inputEnded = count == 0;
+					in = input.data();
+					inEnd = in + count;
+				}
+				const char* inBefore = in;
+				char* outBefore = out;
+				streamEnded = this->decoder->decode(in, inEnd, out, outEnd, inputEnded);
+				if (!streamEnded && inputEnded && in == inBefore && out == outBefore) {
+					throw std::runtime_error("compressed trace is truncated");
+				}
+			}
+			buffer->size = out - buffer->data.data();
+			if (buffer->size == 0) break;
+			if (!this->filledBuffers.push(buffer)) return;
+		}
+	}
+	catch (...) {
+		this->error = std::current_exception();
+	}
+	this->filledBuffers.close();
+}
+
+static Compression detectCompression(const unsigned char* magic, size_t size) {
+	if (size >= 2 && magic[0] == 0x1F && magic[1] == 0x8B) return gzipCompression;
+	if (size >= 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD) return zstdCompression;
+	if (size >= 6 && std::memcmp(magic, "\xFD" "7zXZ\0", 6) == 0) return xzCompression;
+	return noCompression;
+}
+
+bool canMapTrace(const std::string& path) {
+	struct stat status;
+	if (path == "-" || stat(path.c_str(), &status) != 0 || !S_ISREG(status.st_mode) || status.st_size == 0) return false;
+	FileInput file(path);
+	unsigned char magic[6];
+	size_t size = file.peek(magic, sizeof(magic));
+	return detectCompression(magic, size) == noCompression;
+}
+
+MappedFile::MappedFile(const std::string& path) {
+	int fd = open(path.c_str(), O_RDONLY);
+	struct stat status;
+	if (fd < 0 || fstat(fd, &status) != 0) {
+		if (fd >= 0) close(fd);
+		std::string err = std::format("Couldn't open file '{}'. Check if it exists and the path to the file is correct.", path);
+		throw std::runtime_error(err);
+	}
+	this->length = status.st_size;
+	void* mapping = mmap(0, this->length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) throw std::runtime_error(std::format("Couldn't map file '{}': {}", path, std::strerror(errno)));
+	this->begin = (const char*)mapping;
+	madvise(mapping, this->length, MADV_SEQUENTIAL);
+}
+
+MappedFile::~MappedFile() {
+	munmap((void*)this->begin, this->length);
+}
+
+void MappedFile::release(size_t offset, size_t length) {
+	// only whole pages inside the range
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t first = (offset + pageSize - 1) / pageSize * pageSize;
+	size_t last = (offset + length) / pageSize * pageSize;
+	if (last > first) madvise((void*)(this->begin + first), last - first, MADV_DONTNEED);
+}
+
+std::unique_ptr<TraceInput> openTraceInput(const std::string& path) {
+	std::unique_ptr<FileInput> file = std::make_unique<FileInput>(path);
+	unsigned char magic[6];
+	size_t size = file->peek(magic, sizeof(magic));
+	Compression compression = detectCompression(magic, size);
+	if (compression == noCompression) return file;
+	return std::make_unique<DecompressingInput>(std::move(file), compression);
+}
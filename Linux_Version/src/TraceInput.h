@@ -0,0 +1,97 @@
+#pragma once
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SpscQueue.h"
+
+// source of raw trace bytes, read() is called once per chunk, not per record
+class TraceInput {
+public:
+	virtual ~TraceInput() {}
+	// reads up to size bytes into buffer, returns 0 once the input has ended
+	virtual size_t read(char* buffer, size_t size) = 0;
+};
+
+// opens a trace file ("-" for stdin), compressed traces (gzip, zstd, xz) are detected by their magic number
+// and decompressed on a background thread, the file is never seeked
+std::unique_ptr<TraceInput> openTraceInput(const std::string& path);
+
+// true if path is a regular, uncompressed file that can be memory mapped
+bool canMapTrace(const std::string& path);
+
+// read only memory mapping of a whole file
+class MappedFile {
+public:
+	MappedFile(const std::string& path);
+	~MappedFile();
+	const char* data() const { return this->begin; }
+	size_t size() const { return this->length; }
+	// drops the pages of [offset, offset + length) from memory, they are not read again
+	void release(size_t offset, size_t length);
+
+private:
+	const char* begin = 0;
+	size_t length = 0;
+};
+
+// plain file, stdin ("-") or fifo, read with large reads and never seeked
+class FileInput : public TraceInput {
+public:
+	FileInput(const std::string& path);
+	~FileInput();
+	size_t read(char* buffer, size_t size) override;
+	// reads the first bytes, they are returned again by the next read() calls (call before read())
+	size_t peek(unsigned char* buffer, size_t size);
+
+private:
+	int fd = -1;
+	bool ownsFd = true;
+	bool stream = false;		// pipe, fifo or terminal, reads return less than asked for
+	std::vector<char> peeked;
+	size_t peekedPos = 0;
+	size_t readFile(char* buffer, size_t size);
+};
+
+enum Compression { noCompression, gzipCompression, zstdCompression, xzCompression };
+
+// streaming decompressor of one compression format
+class Decoder {
+public:
+	virtual ~Decoder() {}
+	// decompresses from [in, inEnd) into [out, outEnd) and advances in and out
+	// inputEnded: no input follows after inEnd
+	// returns true once the compressed stream has ended
+	virtual bool decode(const char*& in, const char* inEnd, char*& out, char* outEnd, bool inputEnded) = 0;
+};
+
+// decompresses a source on a background thread into a ring of buffers, read() takes the decompressed bytes
+// decompression overlaps with parsing and simulation, buffers are handed over through lock free queues
+class DecompressingInput : public TraceInput {
+public:
+	DecompressingInput(std::unique_ptr<TraceInput> source, Compression compression);
+	~DecompressingInput();
+	size_t read(char* buffer, size_t size) override;
+
+private:
+	static const size_t bufferSize = 1 << 20;
+	static const size_t bufferCount = 8;
+
+	typedef struct Buffer {
+		std::vector<char> data;
+		size_t size = 0;
+	} Buffer;
+
+	std::unique_ptr<TraceInput> source;
+	std::unique_ptr<Decoder> decoder;
+	Buffer buffers[bufferCount];
+	SpscQueue<Buffer*> freeBuffers { bufferCount };		// read() -> decompressor
+	SpscQueue<Buffer*> filledBuffers { bufferCount };	// decompressor -> read()
+	Buffer* current = 0;		// buffer read() takes bytes from
+	size_t readPos = 0;			// bytes of current already consumed
+	std::exception_ptr error;	// set by the decompressor before it closes filledBuffers
+	std::thread worker;
+
+	void decompressLoop();
+};
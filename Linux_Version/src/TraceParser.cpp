@@ -0,0 +1,147 @@
+#include "TraceParser.h"
+#include <cstring>
+#include <stdexcept>
+
+
+// value of a hex digit, or -1
+static inline int hexValue(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+static inline void parseLine(const char* line, const char* lineEnd, std::vector<Access>& batch) {
+	if (lineEnd - line < 12) return;
+	char op = line[2];
+	if (op != '0' && op != '1') return;
+
+	unsigned long long address = 0;
+	int digits = 0;
+	for (; digits < 8; digits++) {
+		int value = hexValue(line[4 + digits]);
+		if (value < 0) break;
+		address = (address << 4) | value;
+	}
+	if (digits == 0) throw std::invalid_argument("trace line without address");
+
+	batch.push_back({ address, op == '0' ? readOp : writeOp });
+}
+
+// hex number at pos, up to 16 digits and an optional "0x", returns false if there is no digit
+static inline bool parseHex(const char*& pos, const char* lineEnd, unsigned long long& value) {
+	if (lineEnd - pos > 2 && pos[0] == '0' && (pos[1] == 'x' || pos[1] == 'X')) pos += 2;
+	value = 0;
+	int digits = 0;
+	for (; digits < 16 && pos < lineEnd; digits++, pos++) {
+		int digit = hexValue(*pos);
+		if (digit < 0) break;
+		value = (value << 4) | digit;
+	}
+	return digits > 0;
+}
+
+static inline void parseDineroLine(const char* line, const char* lineEnd, std::vector<Access>& batch) {
+	while (line < lineEnd && (*line == ' ' || *line == '\t')) line++;
+	if (lineEnd - line < 2) return;
+	char label = line[0];
+	if ((label != '0' && label != '1') || (line[1] != ' ' && line[1] != '\t')) return;
+
+	const char* pos = line + 2;
+	while (pos < lineEnd && (*pos == ' ' || *pos == '\t')) pos++;
+	unsigned long long address;
+	if (!parseHex(pos, lineEnd, address)) throw std::invalid_argument("trace line without address");
+
+	batch.push_back({ address, label == '0' ? readOp : writeOp });
+}
+
+static inline void parseLackeyLine(const char* line, const char* lineEnd, std::vector<Access>& batch) {
+	// data accesses are indented by one space, instruction fetches start with 'I'
+	if (lineEnd - line < 4 || line[0] != ' ' || line[2] != ' ') return;
+	char op = line[1];
+	if (op != 'L' && op != 'S' && op != 'M') return;
+
+	const char* pos = line + 3;
+	unsigned long long address;
+	if (!parseHex(pos, lineEnd, address)) throw std::invalid_argument("trace line without address");
+
+	if (op != 'S') batch.push_back({ address, readOp });
+	if (op != 'L') batch.push_back({ address, writeOp });
+}
+
+// calls lineParser for every line in [begin, end), inlined into each format's parser
+template <void (*lineParser)(const char*, const char*, std::vector<Access>&)>
+static inline const char* parseLines(const char* begin, const char* end, std::vector<Access>& batch, bool final) {
+	const char* line = begin;
+	while (line < end) {
+		const char* lineEnd = (const char*)std::memchr(line, '\n', end - line);
+		if (!lineEnd) {
+			if (!final) return line;
+			lineEnd = end;
+		}
+		lineParser(line, lineEnd, batch);
+		line = lineEnd + 1;
+	}
+	return end;
+}
+
+const char* parseTrace(const char* begin, const char* end, std::vector<Access>& batch, bool final) {
+	return parseLines<parseLine>(begin, end, batch, final);
+}
+
+const char* parseDineroTrace(const char* begin, const char* end, std::vector<Access>& batch, bool final) {
+	return parseLines<parseDineroLine>(begin, end, batch, final);
+}
+
+const char* parseLackeyTrace(const char* begin, const char* end, std::vector<Access>& batch, bool final) {
+	return parseLines<parseLackeyLine>(begin, end, batch, final);
+}
+
+// ChampSim's input_instr, native (little endian) byte order
+typedef struct ChampSimRecord {
+	unsigned long long ip;
+	unsigned char isBranch;
+	unsigned char branchTaken;
+	unsigned char destinationRegisters[2];
+	unsigned char sourceRegisters[4];
+	unsigned long long destinationMemory[2];
+	unsigned long long sourceMemory[4];
+} ChampSimRecord;
+static_assert(sizeof(ChampSimRecord) == champSimRecordSize, "ChampSim records are 64 bytes");
+
+const char* parseChampSimTrace(const char* begin, const char* end, std::vector<Access>& batch, bool final) {
+	const char* record = begin;
+	for (; end - record >= (ptrdiff_t)champSimRecordSize; record += champSimRecordSize) {
+		// records are not aligned after a carried record
+		ChampSimRecord instr;
+		std::memcpy(&instr, record, champSimRecordSize);
+		for (unsigned long long address : instr.sourceMemory) {
+			if (address) batch.push_back({ address, readOp });
+		}
+		for (unsigned long long address : instr.destinationMemory) {
+			if (address) batch.push_back({ address, writeOp });
+		}
+	}
+	if (record != end && final) throw std::invalid_argument("ChampSim trace ends inside a record");
+	return record;
+}
+
+void formatTrace(const Access* accesses, size_t count, std::string& text) {
+	static const char digits[] = "0123456789abcdef";
+	size_t first = text.size();
+	text.resize(first + count * 13);
+	char* out = text.data() + first;
+	for (size_t i = 0; i < count; i++) {
+		unsigned long long address = accesses[i].address;
+		out[0] = '#';
+		out[1] = ' ';
+		out[2] = accesses[i].op == writeOp ? '1' : '0';
+		out[3] = ' ';
+		for (int digit = 7; digit >= 0; digit--) {
+			out[4 + digit] = digits[address & 0xF];
+			address >>= 4;
+		}
+		out[12] = '\n';
+		out += 13;
+	}
+}
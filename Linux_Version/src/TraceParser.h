@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Access.h"
+
+// parses the lines in [begin, end) of the default trace format into batch
+// a line needs at least 12 characters, op at offset 2 ('0' read, '1' write, others are skipped), 8 hex digits at offset 4
+// returns the start of the last incomplete line (end if final, then the rest is parsed as a line too)
+const char* parseTrace(const char* begin, const char* end, std::vector<Access>& batch, bool final);
+
+// parses Dinero "din" lines ("<label> <hex address> [size]") in [begin, end) into batch, same return value as parseTrace
+// label 0 is a read, 1 a write, instruction fetches (2) and the other labels are skipped like in the default format
+const char* parseDineroTrace(const char* begin, const char* end, std::vector<Access>& batch, bool final);
+
+// parses Valgrind lackey lines (" L <hex address>,<size>", " S ...", " M ...") in [begin, end) into batch, same return value as parseTrace
+// a modify (M) is a read followed by a write, instruction fetches ("I  ...") and valgrind messages ("==...") are skipped
+const char* parseLackeyTrace(const char* begin, const char* end, std::vector<Access>& batch, bool final);
+
+// bytes of a ChampSim input_instr record
+const size_t champSimRecordSize = 64;
+
+// parses ChampSim binary records in [begin, end) into batch, returns the start of the last incomplete record
+// every source memory operand is a read, every destination memory operand a write (0 means no operand)
+// a final incomplete record throws
+const char* parseChampSimTrace(const char* begin, const char* end, std::vector<Access>& batch, bool final);
+
+// appends accesses as lines of the default trace format ("# <op> <8 hex digits>"), addresses must fit 32 bit
+void formatTrace(const Access* accesses, size_t count, std::string& text);
@@ -0,0 +1,245 @@
+#include "TracePipeline.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <vector>
+#include "SpscQueue.h"
+
+
+static const size_t chunkSize = 1 << 20;
+static const size_t chunkCount = 8;
+static const size_t batchCount = 8;
+
+typedef struct Chunk {
+	char* data = 0;		// chunkSize bytes, page aligned
+	size_t size = 0;
+} Chunk;
+
+typedef std::vector<Access> Batch;
+
+// queues between the stages, free queues bring buffers back to the stage that fills them
+typedef struct Pipeline {
+	SpscQueue<Chunk*> freeChunks { chunkCount };
+	SpscQueue<Chunk*> filledChunks { chunkCount };
+	SpscQueue<Batch*> freeBatches { batchCount };
+	SpscQueue<Batch*> filledBatches { batchCount };
+	std::exception_ptr ioError;
+	std::exception_ptr parseError;
+
+	// stops all stages, e.g. after an error
+	void cancel() {
+		this->freeChunks.close();
+		this->filledChunks.close();
+		this->freeBatches.close();
+		this->filledBatches.close();
+	}
+} Pipeline;
+
+static void ioStage(Pipeline& pipeline, TraceInput& input, PhaseTime& io) {
+	PhaseTimer timer;
+	try {
+		Chunk* chunk;
+		while (pipeline.freeChunks.pop(chunk)) {
+			timer.start();
+			chunk->size = input.read(chunk->data, chunkSize);
+			timer.stop(io);
+			if (chunk->size == 0) break;
+			if (!pipeline.filledChunks.push(chunk)) return;
+		}
+	}
+	catch (...) {
+		pipeline.ioError = std::current_exception();
+		pipeline.cancel();
+		return;
+	}
+	pipeline.filledChunks.close();
+}
+
+// bytes at the start of [begin, end) that complete a record of which carried bytes are in the previous chunk
+static size_t recordRest(const TraceReader& reader, size_t carried, const char* begin, const char* end) {
+	if (reader.recordSize) {
+		size_t missing = reader.recordSize - carried % reader.recordSize;
+		return missing < (size_t)(end - begin) ? missing : end - begin;
+	}
+	const char* newline = (const char*)std::memchr(begin, '\n', end - begin);
+	return newline ? newline + 1 - begin : end - begin;
+}
+
+static void parseStage(Pipeline& pipeline, TraceFormat format, PhaseTime& parse) {
+	PhaseTimer timer;
+	std::unique_ptr<TraceReader> reader;
+	std::vector<char> carry;	// incomplete last record of the previous chunk
+	try {
+		Chunk* chunk;
+		Batch* batch;
+		while (pipeline.filledChunks.pop(chunk)) {
+			if (!pipeline.freeBatches.pop(batch)) return;
+			timer.start();
+			batch->clear();
+			const char* begin = chunk->data;
+			const char* end = chunk->data + chunk->size;
+			if (!reader) reader = makeTraceReader(format == autoFormat ? detectTraceFormat(begin, end - begin) : format);
+
+			// complete the carried record with the start of this chunk
+			if (!carry.empty()) {
+				size_t rest = recordRest(*reader, carry.size(), begin, end);
+				carry.insert(carry.end(), begin, begin + rest);
+				begin += rest;
+				if (reader->parse(carry.data(), carry.data() + carry.size(), *batch, false) == carry.data() + carry.size()) carry.clear();
+			}
+			const char* rest = reader->parse(begin, end, *batch, false);
+			carry.insert(carry.end(), rest, end);
+			timer.stop(parse);
+
+			if (!pipeline.freeChunks.push(chunk)) return;
+			if (!pipeline.filledBatches.push(batch)) return;
+		}
+
+		// last line without newline, or a cut binary record
+		if (!carry.empty() && pipeline.freeBatches.pop(batch)) {
+			batch->clear();
+			reader->parse(carry.data(), carry.data() + carry.size(), *batch, true);
+			if (!pipeline.filledBatches.push(batch)) return;
+		}
+	}
+	catch (...) {
+		pipeline.parseError = std::current_exception();
+		pipeline.cancel();
+		return;
+	}
+	pipeline.filledBatches.close();
+}
+
+void runTracePipeline(TraceInput& input, Controller& controller, TraceFormat format, PhaseTime& io, PhaseTime& parse, PhaseTime& simulation) {
+	Pipeline pipeline;
+	Chunk chunks[chunkCount];
+	Batch batches[batchCount];
+	for (Chunk& chunk : chunks) {
+		chunk.data = (char*)std::aligned_alloc(4096, chunkSize);
+		pipeline.freeChunks.push(&chunk);
+	}
+	for (Batch& batch : batches) {
+		batch.reserve(chunkSize / 12);		// a line has at least 12 characters
+		pipeline.freeBatches.push(&batch);
+	}
+
+	std::thread ioThread(ioStage, std::ref(pipeline), std::ref(input), std::ref(io));
+	std::thread parseThread(parseStage, std::ref(pipeline), format, std::ref(parse));
+
+	std::exception_ptr simulationError;
+	PhaseTimer timer;
+	try {
+		Batch* batch;
+		while (pipeline.filledBatches.pop(batch)) {
+			timer.start();
+			controller.simulate(*batch);
+			timer.stop(simulation);
+			if (!pipeline.freeBatches.push(batch)) break;
+		}
+	}
+	catch (...) {
+		simulationError = std::current_exception();
+		pipeline.cancel();
+	}
+
+	ioThread.join();
+	parseThread.join();
+	for (Chunk& chunk : chunks) std::free(chunk.data);
+
+	if (pipeline.ioError) std::rethrow_exception(pipeline.ioError);
+	if (pipeline.parseError) std::rethrow_exception(pipeline.parseError);
+	if (simulationError) std::rethrow_exception(simulationError);
+}
+
+// batch of one chunk, reused for every slotCount-th chunk
+typedef struct ChunkSlot {
+	Batch batch;
+	alignas(64) std::atomic<unsigned long long> allowed { 0 };		// chunk the slot may be written for
+	alignas(64) std::atomic<unsigned long long> published { 0 };	// chunk + 1 whose batch is ready
+} ChunkSlot;
+
+// first byte of chunk idx, records belong to the chunk they start in
+static size_t chunkStart(const MappedFile& file, const TraceReader& reader, unsigned long long idx, size_t size) {
+	return reader.recordStart(file.data(), file.size(), idx * size);
+}
+
+void runMappedTrace(const std::string& path, Controller& controller, TraceFormat format, unsigned int parseThreads, PhaseTime& parse, PhaseTime& simulation) {
+	const size_t mappedChunkSize = 4 << 20;
+	MappedFile file(path);
+	if (format == autoFormat) format = detectTraceFormat(file.data(), file.size());
+	// readers keep no state between chunks, one is shared by all parsers
+	std::unique_ptr<TraceReader> reader = makeTraceReader(format);
+	unsigned long long chunks = (file.size() + mappedChunkSize - 1) / mappedChunkSize;
+	unsigned int slotCount = parseThreads * 2;
+	std::vector<ChunkSlot> slots(slotCount);
+	for (unsigned int slot = 0; slot < slotCount; slot++) slots[slot].allowed = slot;
+	std::vector<PhaseTime> parseTimes(parseThreads);
+	std::vector<std::exception_ptr> parseErrors(parseThreads);
+	std::atomic<bool> cancelled { false };
+
+	std::vector<std::thread> parsers;
+	for (unsigned int worker = 0; worker < parseThreads; worker++) {
+		parsers.emplace_back([&, worker] {
+			PhaseTimer timer;
+			try {
+				for (unsigned long long chunk = worker; chunk < chunks; chunk += parseThreads) {
+					ChunkSlot& slot = slots[chunk % slotCount];
+					unsigned int waits = 0;
+					while (slot.allowed.load(std::memory_order_acquire) != chunk) {
+						if (cancelled.load(std::memory_order_relaxed)) return;
+						backOff(waits);
+					}
+
+					timer.start();
+					size_t begin = chunkStart(file, *reader, chunk, mappedChunkSize);
+					size_t end = chunkStart(file, *reader, chunk + 1, mappedChunkSize);
+					slot.batch.clear();
+					reader->parse(file.data() + begin, file.data() + end, slot.batch, true);
+					timer.stop(parseTimes[worker]);
+					slot.published.store(chunk + 1, std::memory_order_release);
+				}
+			}
+			catch (...) {
+				parseErrors[worker] = std::current_exception();
+				cancelled = true;
+			}
+		});
+	}
+
+	std::exception_ptr simulationError;
+	PhaseTimer timer;
+	try {
+		for (unsigned long long chunk = 0; chunk < chunks; chunk++) {
+			ChunkSlot& slot = slots[chunk % slotCount];
+			unsigned int waits = 0;
+			while (slot.published.load(std::memory_order_acquire) != chunk + 1) {
+				if (cancelled.load(std::memory_order_relaxed)) break;
+				backOff(waits);
+			}
+			if (cancelled.load(std::memory_order_relaxed)) break;
+
+			timer.start();
+			controller.simulate(slot.batch);
+			timer.stop(simulation);
+
+			// the chunk is done, its pages are not needed anymore
+			size_t begin = chunkStart(file, *reader, chunk, mappedChunkSize);
+			file.release(begin, chunkStart(file, *reader, chunk + 1, mappedChunkSize) - begin);
+			slot.allowed.store(chunk + slotCount, std::memory_order_release);
+		}
+	}
+	catch (...) {
+		simulationError = std::current_exception();
+		cancelled = true;
+	}
+
+	for (std::thread& parser : parsers) parser.join();
+	for (unsigned int worker = 0; worker < parseThreads; worker++) {
+		parse.wallSeconds += parseTimes[worker].wallSeconds;
+		parse.cpuSeconds += parseTimes[worker].cpuSeconds;
+		if (parseErrors[worker]) std::rethrow_exception(parseErrors[worker]);
+	}
+	if (simulationError) std::rethrow_exception(simulationError);
+}
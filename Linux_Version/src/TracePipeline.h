@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+#include "Controller.h"
+#include "TraceInput.h"
+#include "TraceReader.h"
+#include "Timing.h"
+
+// simulates a trace with three pipelined threads
+// + io thread: reads the input into aligned chunks
+// + parser thread: parses chunks into batches of accesses (records split between chunks are carried over),
+//   an autoFormat trace is detected from its first chunk
+// + calling thread: simulates the batches
+// chunks and batches are handed over through lock free single producer / single consumer queues and recycled,
+// so memory stays bounded and a slow stage blocks the stages before it
+// every stage adds its time to its own PhaseTime
+void runTracePipeline(TraceInput& input, Controller& controller, TraceFormat format, PhaseTime& io, PhaseTime& parse, PhaseTime& simulation);
+
+// simulates a regular, uncompressed trace file with parseThreads parallel parsers
+// the mapped file is split at record boundaries into chunks, chunk i is parsed by thread i % parseThreads,
+// batches are simulated in trace order, at most 2 * parseThreads chunks are in flight
+// parse gets the summed time of all parser threads
+void runMappedTrace(const std::string& path, Controller& controller, TraceFormat format, unsigned int parseThreads, PhaseTime& parse, PhaseTime& simulation);
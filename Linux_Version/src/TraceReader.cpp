@@ -0,0 +1,96 @@
+#include "TraceReader.h"
+#include <cctype>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include "TraceParser.h"
+
+
+typedef const char* (*ParseFunction)(const char* begin, const char* end, std::vector<Access>& batch, bool final);
+
+template <ParseFunction parseFunction>
+class FormatReader : public TraceReader {
+public:
+	FormatReader(TraceFormat format, size_t recordSize) : TraceReader(format, recordSize) {}
+	const char* parse(const char* begin, const char* end, std::vector<Access>& batch, bool final) override {
+		return parseFunction(begin, end, batch, final);
+	}
+};
+
+size_t TraceReader::recordStart(const char* data, size_t size, size_t pos) const {
+	if (pos == 0) return 0;
+	if (pos >= size) return size;
+	if (this->recordSize) {
+		size_t start = (pos + this->recordSize - 1) / this->recordSize * this->recordSize;
+		return start < size ? start : size;
+	}
+	// a line starts after the newline at or after pos - 1
+	const char* newline = (const char*)std::memchr(data + pos - 1, '\n', size - pos + 1);
+	return newline ? newline + 1 - data : size;
+}
+
+std::unique_ptr<TraceReader> makeTraceReader(TraceFormat format) {
+	switch (format) {
+	case dineroFormat: return std::make_unique<FormatReader<parseDineroTrace>>(format, 0);
+	case lackeyFormat: return std::make_unique<FormatReader<parseLackeyTrace>>(format, 0);
+	case champSimFormat: return std::make_unique<FormatReader<parseChampSimTrace>>(format, champSimRecordSize);
+	case defaultFormat: return std::make_unique<FormatReader<parseTrace>>(format, 0);
+	default: throw std::logic_error("trace format has to be detected before a reader is made");
+	}
+}
+
+// "<any> <op> <8 hex digits>", also matches lines whose first char is a digit, so it is tested before din
+static bool isDefaultLine(const char* line, size_t length) {
+	if (length < 12 || line[1] != ' ' || line[3] != ' ' || (line[2] != '0' && line[2] != '1')) return false;
+	for (size_t i = 4; i < 12; i++) {
+		if (!std::isxdigit((unsigned char)line[i])) return false;
+	}
+	return true;
+}
+
+TraceFormat detectTraceFormat(const char* data, size_t size) {
+	const size_t sampleSize = 4096;
+	if (size > sampleSize) size = sampleSize;
+
+	// control characters: binary records
+	for (size_t i = 0; i < size; i++) {
+		unsigned char c = data[i];
+		if (c < 0x20 && c != '\n' && c != '\r' && c != '\t') return champSimFormat;
+	}
+
+	// first line that tells the formats apart
+	const char* line = data;
+	const char* end = data + size;
+	while (line < end) {
+		const char* lineEnd = (const char*)std::memchr(line, '\n', end - line);
+		if (!lineEnd) lineEnd = end;
+		size_t length = lineEnd - line;
+		if (isDefaultLine(line, length)) return defaultFormat;
+		if (length >= 2 && line[0] == '=' && line[1] == '=') return lackeyFormat;
+		if (length >= 4 && line[0] == 'I' && line[1] == ' ' && line[2] == ' ') return lackeyFormat;
+		if (length >= 4 && line[0] == ' ' && (line[1] == 'L' || line[1] == 'S' || line[1] == 'M') && line[2] == ' ') return lackeyFormat;
+		if (length >= 3 && line[0] >= '0' && line[0] <= '9' && (line[1] == ' ' || line[1] == '\t')) return dineroFormat;
+		line = lineEnd + 1;
+	}
+	return defaultFormat;
+}
+
+TraceFormat parseTraceFormat(const std::string& name) {
+	if (name == "auto") return autoFormat;
+	if (name == "default") return defaultFormat;
+	if (name == "din" || name == "dinero") return dineroFormat;
+	if (name == "lackey") return lackeyFormat;
+	if (name == "champsim") return champSimFormat;
+	std::string err = std::format("trace format({}) is not default, din, lackey, champsim or auto", name);
+	throw std::invalid_argument(err);
+}
+
+const char* traceFormatName(TraceFormat format) {
+	switch (format) {
+	case defaultFormat: return "default";
+	case dineroFormat: return "din";
+	case lackeyFormat: return "lackey";
+	case champSimFormat: return "champsim";
+	default: return "auto";
+	}
+}
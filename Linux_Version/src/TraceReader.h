@@ -0,0 +1,32 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "Access.h"
+
+enum TraceFormat { autoFormat, defaultFormat, dineroFormat, lackeyFormat, champSimFormat };
+
+// parser of one trace format, parse() is called once per chunk and the format's parser loop is inlined into it,
+// so there is no virtual call per record
+class TraceReader {
+public:
+	TraceReader(TraceFormat format, size_t recordSize) : format(format), recordSize(recordSize) {}
+	virtual ~TraceReader() {}
+	// parses the records in [begin, end) into batch
+	// returns the start of the last incomplete record (end if final, then the rest is parsed too or rejected)
+	virtual const char* parse(const char* begin, const char* end, std::vector<Access>& batch, bool final) = 0;
+	// offset of the first record starting at or after pos, data has to start at a record
+	size_t recordStart(const char* data, size_t size, size_t pos) const;
+
+	const TraceFormat format;
+	const size_t recordSize;		// bytes of a binary record, 0 for line based formats
+};
+
+std::unique_ptr<TraceReader> makeTraceReader(TraceFormat format);
+
+// guesses the format from the first bytes of a trace, falls back to the default format
+TraceFormat detectTraceFormat(const char* data, size_t size);
+
+// default|din|lackey|champsim|auto
+TraceFormat parseTraceFormat(const std::string& name);
+const char* traceFormatName(TraceFormat format);
@@ -0,0 +1,49 @@
+#include "VictimCache.h"
+#include <format>
+#include <stdexcept>
+#include <string>
+
+
+VictimCache::VictimCache(unsigned int entries) {
+	if (entries == 0 || entries > maxEntries) {
+		std::string err = std::format("victim cache entries({}) has to be between 1 and {}", entries, maxEntries);
+		throw std::invalid_argument(err);
+	}
+	this->entries = entries;
+	this->paddedEntries = (entries + 7) / 8 * 8;
+	this->blocksLow.assign(this->paddedEntries, 0);
+	this->blocksHigh.assign(this->paddedEntries, 0);
+	this->validSectors.assign(entries, 0);
+	this->dirtySectors.assign(entries, 0);
+}
+
+void VictimCache::take(int slot, unsigned short& validSectors, unsigned short& dirtySectors) {
+	validSectors = this->validSectors[slot];
+	dirtySectors = this->dirtySectors[slot];
+	this->validMask &= ~(1ULL << slot);
+	this->dirtySectors[slot] = 0;
+}
+
+bool VictimCache::insert(unsigned long long block, unsigned short validSectors, unsigned short dirtySectors, unsigned long long& displacedBlock, unsigned short& displacedDirtySectors) {
+	unsigned long long allSlots = this->entries == 64 ? ~0ULL : (1ULL << this->entries) - 1;
+	unsigned long long free = ~this->validMask & allSlots;
+	unsigned int slot;
+	bool displaced = false;
+	if (free) {
+		slot = __builtin_ctzll(free);
+	}
+	else {
+		slot = this->nextReplace;
+		this->nextReplace = (this->nextReplace + 1) % this->entries;
+		displacedBlock = this->getBlock(slot);
+		displacedDirtySectors = this->dirtySectors[slot];
+		displaced = true;
+	}
+
+	this->blocksLow[slot] = (unsigned int)block;
+	this->blocksHigh[slot] = (unsigned int)(block >> 32);
+	this->validMask |= 1ULL << slot;
+	this->validSectors[slot] = validSectors;
+	this->dirtySectors[slot] = dirtySectors;
+	return displaced;
+}
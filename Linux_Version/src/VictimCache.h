@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+
+// small fully associative buffer for the cells evicted from the cache, holds up to 64 blocks
+// (block address: address without offset), a miss in the cache probes it before going to memory
+class VictimCache {
+public:
+	static constexpr unsigned int maxEntries = 64;
+
+	VictimCache(unsigned int entries);
+	// slot holding block or -1, most probes miss: all slots are compared without an early exit
+	// (vectorized, on 32 bit halves, sse2 has no 64 bit compare), only a match is looked up slot by slot
+	int find(unsigned long long block) const {
+		const unsigned int* low = this->blocksLow.data();
+		const unsigned int* high = this->blocksHigh.data();
+		unsigned int blockLow = (unsigned int)block;
+		unsigned int blockHigh = (unsigned int)(block >> 32);
+		unsigned int padded = this->paddedEntries;
+		unsigned int match = 0;
+		for (unsigned int slot = 0; slot < padded; slot++) {
+			match |= (low[slot] == blockLow) & (high[slot] == blockHigh);
+		}
+		if (!match) return -1;
+		for (unsigned int slot = 0; slot < this->entries; slot++) {
+			if (low[slot] == blockLow && high[slot] == blockHigh && ((this->validMask >> slot) & 1)) return slot;
+		}
+		return -1;
+	}
+	// removes the block in slot (swapped back into the cache), returns its valid and dirty sectors
+	void take(int slot, unsigned short& validSectors, unsigned short& dirtySectors);
+	// stores an evicted block in a free slot, or in place of the oldest one
+	// returns true if a valid block was displaced, which then leaves the cache level
+	bool insert(unsigned long long block, unsigned short validSectors, unsigned short dirtySectors, unsigned long long& displacedBlock, unsigned short& displacedDirtySectors);
+	unsigned int getEntries() const { return this->entries; }
+	// for the end of trace write back, 0 for free slots
+	unsigned short getDirtySectors(unsigned int slot) const { return this->dirtySectors[slot]; }
+	unsigned long long getBlock(unsigned int slot) const { return ((unsigned long long)this->blocksHigh[slot] << 32) | this->blocksLow[slot]; }
+	void clean(unsigned int slot) { this->dirtySectors[slot] = 0; }
+
+private:
+	unsigned int entries;
+	unsigned int paddedEntries;				// entries rounded up to 8, padding and free slots are filtered by validMask
+	std::vector<unsigned int> blocksLow;
+	std::vector<unsigned int> blocksHigh;
+	std::vector<unsigned short> validSectors;
+	std::vector<unsigned short> dirtySectors;
+	unsigned long long validMask = 0;
+	unsigned int nextReplace = 0;			// fifo position, used once every slot is valid
+};
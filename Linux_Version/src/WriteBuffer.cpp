@@ -0,0 +1,57 @@
+#include "WriteBuffer.h"
+#include <stdexcept>
+
+
+WriteBuffer::WriteBuffer(unsigned int entries, unsigned int blockSize, unsigned int storeSize) {
+	if (entries == 0) throw std::invalid_argument("write buffer needs at least 1 entry");
+	this->entries = entries;
+	this->storeSize = storeSize;
+	unsigned int words = blockSize > storeSize ? blockSize / storeSize : 1;
+	this->wordMasks = (words + 63) / 64;
+	this->blocks.assign(entries, 0);
+	this->written.assign((size_t)entries * this->wordMasks, 0);
+}
+
+bool WriteBuffer::store(unsigned long long block, unsigned int offset, unsigned long long& drainedBytes) {
+	drainedBytes = 0;
+	unsigned int word = offset / this->storeSize;
+	unsigned long long bit = 1ULL << (word % 64);
+
+	for (unsigned int i = 0; i < this->used; i++) {
+		unsigned int entry = (this->oldest + i) % this->entries;
+		if (this->blocks[entry] != block) continue;
+		this->written[(size_t)entry * this->wordMasks + word / 64] |= bit;
+		return true;
+	}
+
+	// full: the oldest entry is written to memory and reused
+	if (this->used == this->entries) {
+		drainedBytes = this->drain(this->oldest);
+		this->oldest = (this->oldest + 1) % this->entries;
+		this->used--;
+	}
+	unsigned int entry = (this->oldest + this->used) % this->entries;
+	this->blocks[entry] = block;
+	this->written[(size_t)entry * this->wordMasks + word / 64] |= bit;
+	this->used++;
+	return false;
+}
+
+unsigned int WriteBuffer::drainAll(unsigned long long& drainedBytes) {
+	unsigned int drained = this->used;
+	for (unsigned int i = 0; i < this->used; i++) {
+		drainedBytes += this->drain((this->oldest + i) % this->entries);
+	}
+	this->used = 0;
+	return drained;
+}
+
+unsigned long long WriteBuffer::drain(unsigned int entry) {
+	unsigned long long words = 0;
+	unsigned long long* masks = &this->written[(size_t)entry * this->wordMasks];
+	for (unsigned int i = 0; i < this->wordMasks; i++) {
+		words += __builtin_popcountll(masks[i]);
+		masks[i] = 0;
+	}
+	return words * this->storeSize;
+}
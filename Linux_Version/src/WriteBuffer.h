@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+
+// write combining buffer in front of memory, for stores that are not kept in the cache (writeThrough, noAllocate)
+// every entry holds one block (address without offset) and the store sized words written to it,
+// stores to a block in the buffer are combined, the oldest entry is drained once all entries are used
+// reads do not look into the buffer, it only models the write traffic
+class WriteBuffer {
+public:
+	WriteBuffer(unsigned int entries, unsigned int blockSize, unsigned int storeSize);
+	// returns true if the store was combined with an earlier store to the block
+	// drainedBytes is set to the bytes written to memory by a drained entry, 0 if nothing was drained
+	bool store(unsigned long long block, unsigned int offset, unsigned long long& drainedBytes);
+	// drains every entry (end of trace), returns the drained entries and adds their bytes to drainedBytes
+	unsigned int drainAll(unsigned long long& drainedBytes);
+
+private:
+	unsigned int entries;
+	unsigned int storeSize;
+	unsigned int wordMasks;				// 64 bit masks per entry, one bit per word
+	std::vector<unsigned long long> blocks;
+	std::vector<unsigned long long> written;	// entries * wordMasks
+	unsigned int oldest = 0;			// ring of used entries, in the order they were allocated
+	unsigned int used = 0;
+
+	// bytes of the words written to entry, clears its mask
+	unsigned long long drain(unsigned int entry);
+};
@@ -1,12 +1,32 @@
 #pragma once
 #include <cmath>
+#include <format>
+#include <stdexcept>
+#include <string>
 
-bool isOfBase2(double number) {
+inline bool isOfBase2(double number) {
 	double res = log2(number);
 	return ceil(res) ==  floor(res);
 }
 
-int log2i(double number) {
+inline int log2i(double number) {
 	return static_cast<int>(log2(number));
 }
 
+// parses sizes like "4096", "64K", "16M" or "1G" (powers of 1024)
+inline unsigned long long parseSize(const std::string& text) {
+	size_t digits = 0;
+	unsigned long long value = 0;
+	try {
+		value = std::stoull(text, &digits);
+	}
+	catch (const std::exception& e) {
+		throw std::invalid_argument(std::format("'{}' is not a size", text));
+	}
+	std::string suffix = text.substr(digits);
+	if (suffix == "") return value;
+	if (suffix == "K" || suffix == "k") return value << 10;
+	if (suffix == "M" || suffix == "m") return value << 20;
+	if (suffix == "G" || suffix == "g") return value << 30;
+	throw std::invalid_argument(std::format("'{}' is not a size, use [K|M|G] as suffix", text));
+}
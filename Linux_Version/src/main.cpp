@@ -2,9 +2,24 @@
 #include <fstream>
 #include "Controller.h"
 #include "Cache.h"
+#include "ResultWriter.h"
+#include "TraceParser.h"
+#include "TraceInput.h"
+#include "TracePipeline.h"
+#include "TraceReader.h"
+#include "Timing.h"
+#include "SyntheticTrace.h"
+#include "ShmRing.h"
+#include "Server.h"
+#include "helper.h"
 #include <time.h>
+#include <chrono>
+#include <cstring>
+#include <vector>
 #include <format>
 #include <stdlib.h>
+#include <atomic>
+#include <csignal>
 #include "cxxopts.hpp"
 
 /* Console Interface
@@ -18,7 +33,150 @@
 * writeMissPolicy allocate|noAllocate 
 */
 
+// generates the stream in batches and simulates them, generation is timed as parsing
+static void runSynthetic(SyntheticTrace& synthetic, unsigned long long accesses, Controller& controller, RunInfo& run) {
+    const size_t batchSize = 1 << 16;
+    std::vector<Access> batch;
+    batch.reserve(batchSize);
+    PhaseTimer timer;
+
+    while (accesses > 0) {
+        size_t count = accesses < batchSize ? accesses : batchSize;
+        accesses -= count;
+
+        timer.start();
+        batch.clear();
+        synthetic.generate(batch, count);
+        timer.stop(run.parse);
+
+        timer.start();
+        controller.simulate(batch);
+        timer.stop(run.simulation);
+    }
+}
+
+static void addSyntheticOptions(cxxopts::Options& options) {
+    options.add_options("synthetic")
+        ("n,accesses",    "Number of generated accesses       [uint]  ", cxxopts::value<unsigned long long>()->default_value("10000000"))
+        ("footprint",     "Bytes covered by the stream [size, K|M|G]  ", cxxopts::value<std::string>()->default_value("16M"))
+        ("stride",        "Bytes between elements             [uint]  ", cxxopts::value<unsigned int>()->default_value("64"))
+        ("zipf-s",        "Zipf skew s                        [double]", cxxopts::value<double>()->default_value("1.0"))
+        ("write-ratio",   "Share of writes                    [double]", cxxopts::value<double>()->default_value("0.0"))
+        ("seed",          "Random seed                        [uint]  ", cxxopts::value<unsigned long long>()->default_value("1"))
+        ("base",          "First address                      [hex]   ", cxxopts::value<std::string>()->default_value("0"));
+}
+
+static StreamConfig syntheticConfig(const cxxopts::ParseResult& result, const std::string& stream) {
+    StreamConfig config;
+    config.kind = SyntheticTrace::parseKind(stream);
+    config.footprint = parseSize(result["footprint"].as<std::string>());
+    config.stride = result["stride"].as<unsigned int>();
+    config.zipfS = result["zipf-s"].as<double>();
+    config.writeRatio = result["write-ratio"].as<double>();
+    config.seed = result["seed"].as<unsigned long long>();
+    config.base = std::stoull(result["base"].as<std::string>(), 0, 16);
+    return config;
+}
+
+// CacheSim gen <stream>: writes a synthetic stream as trace file
+static int generateTrace(int argc, char *argv[]) {
+    cxxopts::Options options("CacheSim gen", "Writes a synthetic access stream as trace file");
+    options
+        .set_width(100)
+        .add_options()
+        ("h,help",   "Print help screen")
+        ("stream",   "Stream [sequential|strided|random|zipf|chase|stencil|matrix]", cxxopts::value<std::string>())
+        ("o,output", "Path to trace file [string]", cxxopts::value<std::string>());
+    addSyntheticOptions(options);
+    options.parse_positional({ "stream" });
+    options.positional_help("<stream>");
+
+    try {
+        cxxopts::ParseResult result = options.parse(argc, argv);
+        if (result.count("help")) {
+            std::cout << options.help() << std::endl;
+            return 0;
+        }
+        if (!result.count("stream") || !result.count("output")) {
+            cxxopts::throw_or_mimic<cxxopts::exceptions::exception>("gen needs a stream and -o");
+        }
+
+        StreamConfig config = syntheticConfig(result, result["stream"].as<std::string>());
+        // the default trace format has 8 hex digits per address
+        if (config.base + config.footprint > (1ULL << 32)) {
+            std::string error = std::format("base({:#x}) + footprint({}) does not fit 32 bit addresses", config.base, config.footprint);
+            throw std::invalid_argument(error);
+        }
+        SyntheticTrace synthetic(config);
+        unsigned long long accesses = result["accesses"].as<unsigned long long>();
+        std::string output = result["output"].as<std::string>();
+        std::ofstream outputFile(output, std::ios::binary);
+        if (!outputFile.is_open()) {
+            std::string error = std::format("Couldn't open file '{}'. Check if it exists and the path to the file is correct.", output);
+            throw std::runtime_error(error);
+        }
+
+        const size_t batchSize = 1 << 16;
+        std::vector<Access> batch;
+        std::string text;
+        while (accesses > 0) {
+            size_t count = accesses < batchSize ? accesses : batchSize;
+            accesses -= count;
+            batch.clear();
+            text.clear();
+            synthetic.generate(batch, count);
+            formatTrace(batch.data(), batch.size(), text);
+            outputFile.write(text.data(), text.size());
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << '\n';
+        std::cerr << "usage: see help -h/--help\n";
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
+
+static std::atomic<bool> stopServer { false };
+
+// CacheSim serve: keeps cache instances resident for clients on a Unix socket, until SIGINT or SIGTERM
+static int serve(int argc, char *argv[]) {
+    cxxopts::Options options("CacheSim serve", "Simulates batches of accesses for clients of a Unix domain socket");
+    options
+        .set_width(100)
+        .add_options()
+        ("h,help",   "Print help screen")
+        ("socket",   "Path to the socket [string]", cxxopts::value<std::string>()->default_value("/tmp/cachesim.sock"));
+
+    try {
+        cxxopts::ParseResult result = options.parse(argc, argv);
+        if (result.count("help")) {
+            std::cout << options.help() << std::endl;
+            return 0;
+        }
+
+        Server server(result["socket"].as<std::string>());
+        std::signal(SIGINT, [](int) { stopServer = true; });
+        std::signal(SIGTERM, [](int) { stopServer = true; });
+        std::cout << std::format("serving on '{}'", result["socket"].as<std::string>()) << std::endl;
+        server.run(stopServer);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << '\n';
+        std::cerr << "usage: see help -h/--help\n";
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "gen") {
+        return generateTrace(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::string(argv[1]) == "serve") {
+        return serve(argc - 1, argv + 1);
+    }
+
     cxxopts::Options options("Cache Sim", "Simulates a cache with options to configure it");
 
     options
@@ -29,11 +187,51 @@ int main(int argc, char *argv[]) {
         ("a,associativity", "Cache associativity                [uint]  ", cxxopts::value<unsigned int>()->default_value("1"))
         ("e,evict",  "Evicton Policy    [LRU|fifo|random]        ",        cxxopts::value<std::string>()->default_value("LRU"))
         ("w,hit",    "Write hit Policy  [writeBack|writeThrough] ",        cxxopts::value<std::string>()->default_value("writeBack"))
-        ("m,miss",   "Write miss Policy [allocate|noAllocate]    ",        cxxopts::value<std::string>()->default_value("allocate"));
+        ("m,miss",   "Write miss Policy [allocate|noAllocate]    ",        cxxopts::value<std::string>()->default_value("allocate"))
+        ("prefetch", "Prefetcher [none|nextline|stride|stream]   ",        cxxopts::value<std::string>()->default_value("none"))
+        ("prefetch-degree", "Blocks per prefetch, stream depth for stream [uint]", cxxopts::value<unsigned int>()->default_value("2"))
+        ("prefetch-delay", "Accesses until a prefetch fill arrives [uint]", cxxopts::value<unsigned int>()->default_value("4"))
+        ("victim-cache", "Cells of a fully associative victim cache, 0: none [uint]", cxxopts::value<unsigned int>()->default_value("0"))
+        ("sectors", "Sectors per cache cell, loaded on demand [uint]", cxxopts::value<unsigned int>()->default_value("1"))
+        ("write-buffer", "Blocks in a write combining buffer for write throughs, 0: none [uint]", cxxopts::value<unsigned int>()->default_value("0"));
+    options.add_options("tlb")
+        ("tlb", "Simulate a DTLB and STLB next to the cache")
+        ("page-size", "Page size [4K|2M|1G]", cxxopts::value<std::string>()->default_value("4K"))
+        ("dtlb", "DTLB entries [uint]", cxxopts::value<unsigned int>()->default_value("64"))
+        ("dtlb-ways", "DTLB associativity [uint]", cxxopts::value<unsigned int>()->default_value("4"))
+        ("stlb", "STLB entries [uint]", cxxopts::value<unsigned int>()->default_value("1536"))
+        ("stlb-ways", "STLB associativity [uint]", cxxopts::value<unsigned int>()->default_value("12"))
+        ("pwc", "Page walk cache entries, 0: none [uint]", cxxopts::value<unsigned int>()->default_value("0"))
+        ("tlb-evict", "TLB eviction policy [LRU|fifo|random]", cxxopts::value<std::string>()->default_value("LRU"));
     options.add_options("simulator")
 		("h,help",  "Print help screen")
+		("j,parse-threads", "Parser threads for uncompressed trace files [uint]", cxxopts::value<unsigned int>()->default_value("1"))
+		("timing", "Report wall and cpu time of trace io, parsing and simulation")
+		("classify", "Split misses into compulsory, capacity and conflict misses")
+		("reuse", "Path to reuse time histogram file (csv) [string]", cxxopts::value<std::string>())
+		("reuse-distance", "Add reuse distance (unique blocks in between) to --reuse histograms")
+		("latency", "Estimate cycles and the average memory access time from hit and memory latency")
+		("hit-latency", "Cycles of a cache hit [uint]", cxxopts::value<unsigned int>()->default_value("4"))
+		("memory-latency", "Cycles of a memory access [uint]", cxxopts::value<unsigned int>()->default_value("200"))
+		("bandwidth", "Memory bytes per cycle, 0: unlimited [double]", cxxopts::value<double>()->default_value("0"))
+		("latency-histogram", "Path to access latency histogram file (csv), implies --latency [string]", cxxopts::value<std::string>())
+		("interval", "Write counter deltas every N accesses [uint]", cxxopts::value<unsigned long long>())
+		("interval-output", "Path to interval file, csv or jsonl (.jsonl) [string]", cxxopts::value<std::string>()->default_value("intervals.csv"))
+		("set-stats", "Path to per set statistics file, csv or binary (.bin) [string]", cxxopts::value<std::string>())
 		("o,output","Path to output file [string]", cxxopts::value<std::string>()->default_value(""))
-        ("t,trace", "Path to trace file  [string]", cxxopts::value<std::string>());
+		("f,format","Results format [text|json|csv], json/csv go to stdout without -o", cxxopts::value<std::string>()->default_value("text"))
+        ("t,trace", "Path to trace file, - for stdin [string]", cxxopts::value<std::string>())
+        ("trace-format", "Trace format [default|din|lackey|champsim|auto]", cxxopts::value<std::string>()->default_value("auto"))
+        ("shm", "Simulate accesses of a live process from the shared memory ring <name> [string]", cxxopts::value<std::string>())
+        ("shm-size", "Records in the shared memory ring [size, K|M|G]", cxxopts::value<std::string>()->default_value("1M"))
+        ("shm-drop", "Producer drops accesses while the ring is full, instead of waiting")
+        ("warmup", "Accesses that fill the cache before counting starts [uint]", cxxopts::value<unsigned long long>()->default_value("0"))
+        ("warmup-until-full", "Warm up until every set is full (or --warmup accesses passed)")
+        ("fast-forward", "Warmup accesses only update the cache, analyzers skip them too")
+        ("save-state", "Path to save the cache state to after the trace, before the final write back [string]", cxxopts::value<std::string>())
+        ("load-state", "Path to a cache state to start from (same cache configuration) [string]", cxxopts::value<std::string>())
+        ("synthetic", "Simulate a generated stream instead of a trace [sequential|strided|random|zipf|chase|stencil|matrix]", cxxopts::value<std::string>());
+    addSyntheticOptions(options);
 
     // parse arguments
     cxxopts::ParseResult result;
@@ -58,12 +256,14 @@ int main(int argc, char *argv[]) {
     EvictionPolicy evictionPolicy = LRU;
     WriteHitPolicy writeHitPolicy = writeBack;
     WriteMissPolicy writeMissPolicy = allocate;
+    OutputFormat outputFormat = textOutput;
     std::string trace = "";
     std::string output = "";
 
     std::string evict = "";
 	std::string hit = "";
 	std::string miss = "";
+	std::string format = "";
     try
     {
 		cellCount = result["cellCount"].as<std::uint32_t>();
@@ -72,8 +272,11 @@ int main(int argc, char *argv[]) {
         evict = result["evict"].as<std::string>();
         hit = result["hit"].as<std::string>();
         miss = result["miss"].as<std::string>();
-        trace = result["trace"].as<std::string>();
+        if (!result.count("synthetic") && !result.count("shm")) {
+            trace = result["trace"].as<std::string>();
+        }
         output = result["output"].as<std::string>();
+        format = result["format"].as<std::string>();
 
         if (evict == "LRU") {
             evictionPolicy = LRU;
@@ -110,6 +313,20 @@ int main(int argc, char *argv[]) {
             std::string error = std::format("Argument 'miss' must be [allocate|noAllocate] and not '{}'", miss);
             cxxopts::throw_or_mimic<cxxopts::exceptions::exception>(error);
         }
+
+        if (format == "text") {
+            outputFormat = textOutput;
+        }
+        else if (format == "json") {
+            outputFormat = jsonOutput;
+        }
+        else if (format == "csv") {
+            outputFormat = csvOutput;
+        }
+        else {
+            std::string error = std::format("Argument 'format' must be [text|json|csv] and not '{}'", format);
+            cxxopts::throw_or_mimic<cxxopts::exceptions::exception>(error);
+        }
     }
     catch (const cxxopts::exceptions::exception &e)
     {
@@ -124,37 +341,120 @@ int main(int argc, char *argv[]) {
     try
     {
 		Controller controller = Controller(cellCount, blockSize, associativity, evictionPolicy, writeHitPolicy, writeMissPolicy);
-        std::cout << "Cache Sim started:\n";
-        std::cout << std::format("  cellCount: {}\n  blockSize: {}\n  associativity: {}\n  evictionPolicy: {}\n  writeHitPolicy: {}\n  writeMissPolicy: {}\n\n", cellCount, blockSize, associativity, evict, hit, miss) << "\n";
-        
-
-		std::ifstream traceFile;
-		traceFile.open(trace);
+        controller.enablePrefetcher(Prefetcher::parseKind(result["prefetch"].as<std::string>()), result["prefetch-degree"].as<unsigned int>(), result["prefetch-delay"].as<unsigned int>());
+        controller.setSectors(result["sectors"].as<unsigned int>());
+        controller.enableVictimCache(result["victim-cache"].as<unsigned int>());
+        controller.enableWriteBuffer(result["write-buffer"].as<unsigned int>());
+        if (result.count("latency") || result.count("latency-histogram")) {
+            controller.enableLatencyModel(result["hit-latency"].as<unsigned int>(), result["memory-latency"].as<unsigned int>(), result["bandwidth"].as<double>());
+        }
+        if (result.count("tlb")) {
+            TlbConfig tlbConfig;
+            tlbConfig.pageSize = Tlb::parsePageSize(result["page-size"].as<std::string>());
+            tlbConfig.dtlbEntries = result["dtlb"].as<unsigned int>();
+            tlbConfig.dtlbWays = result["dtlb-ways"].as<unsigned int>();
+            tlbConfig.stlbEntries = result["stlb"].as<unsigned int>();
+            tlbConfig.stlbWays = result["stlb-ways"].as<unsigned int>();
+            tlbConfig.pwcEntries = result["pwc"].as<unsigned int>();
+            std::string tlbEvict = result["tlb-evict"].as<std::string>();
+            if (tlbEvict == "fifo") {
+                tlbConfig.evictionPolicy = fifo;
+            }
+            else if (tlbEvict == "random") {
+                tlbConfig.evictionPolicy = random;
+            }
+            else if (tlbEvict != "LRU") {
+                throw std::invalid_argument(std::format("Argument 'tlb-evict' must be [LRU|fifo|random] and not '{}'", tlbEvict));
+            }
+            controller.enableTlb(tlbConfig);
+        }
+        if (result.count("classify")) {
+            controller.enableMissClassification();
+        }
+        if (result.count("interval")) {
+            controller.enableIntervalStats(result["interval"].as<unsigned long long>(), result["interval-output"].as<std::string>());
+        }
+        if (result.count("reuse")) {
+            controller.enableReuseAnalysis(result.count("reuse-distance") > 0);
+        }
+        if (result.count("save-state")) {
+            controller.checkStateSaveable();
+        }
+        if (result.count("load-state")) {
+            controller.readState(result["load-state"].as<std::string>());
+        }
+        if (result["warmup"].as<unsigned long long>() > 0 || result.count("warmup-until-full")) {
+            controller.setWarmup(result["warmup"].as<unsigned long long>(), result.count("warmup-until-full") > 0, result.count("fast-forward") > 0);
+        }
+        // structured results on stdout must not be mixed with text
+        bool recordToStdout = outputFormat != textOutput && output == "";
+        if (!recordToStdout) {
+            std::cout << "Cache Sim started:\n";
+            std::cout << std::format("  cellCount: {}\n  blockSize: {}\n  associativity: {}\n  evictionPolicy: {}\n  writeHitPolicy: {}\n  writeMissPolicy: {}\n\n", cellCount, blockSize, associativity, evict, hit, miss) << "\n";
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
         
 
-        if (!traceFile.is_open()) {
-            std::string error = std::format("Couldn't open file '{}'. Check if it exists and the path to the file is correct.", trace);
-            throw std::runtime_error(error);
+        RunInfo run;
+        if (result.count("synthetic")) {
+            std::string stream = result["synthetic"].as<std::string>();
+            SyntheticTrace synthetic(syntheticConfig(result, stream));
+            runSynthetic(synthetic, result["accesses"].as<unsigned long long>(), controller, run);
+            trace = "synthetic:" + stream;
         }
-
-		while (traceFile) {
-		std::string line;
-			std::getline(traceFile, line);
-			if (line.length() < 12) continue;
-			std::string operation = line.substr(2, 1);
-			unsigned int address = std::stoul(line.substr(4, 8), 0, 16);
-
-			if (operation == "0") {
-				controller.read(address);
-			}
-			if (operation == "1") {
-				controller.write(address);
-			}
-		}
-        traceFile.close();
+        else if (result.count("shm")) {
+            ShmRing ring(result["shm"].as<std::string>(), parseSize(result["shm-size"].as<std::string>()), result.count("shm-drop") > 0);
+            std::cerr << std::format("waiting for accesses in shared memory '{}'\n", ring.getName());
+            ring.consume(controller, run.simulation);
+            run.droppedAccesses = ring.dropped();
+            trace = "shm:" + ring.getName();
+        }
+        else {
+            TraceFormat traceFormat = parseTraceFormat(result["trace-format"].as<std::string>());
+            unsigned int parseThreads = result["parse-threads"].as<unsigned int>();
+            if (parseThreads > 1 && canMapTrace(trace)) {
+                runMappedTrace(trace, controller, traceFormat, parseThreads, run.parse, run.simulation);
+            }
+            else {
+                // compressed traces are decompressed on the fly
+                std::unique_ptr<TraceInput> traceInput = openTraceInput(trace);
+                runTracePipeline(*traceInput, controller, traceFormat, run.io, run.parse, run.simulation);
+            }
+        }
+        if (controller.isWarmingUp()) {
+            std::cerr << "warning: the trace ended during the warmup, no access was counted\n";
+        }
+        // a warmed state keeps its dirty cells
+        if (result.count("save-state")) {
+            controller.writeState(result["save-state"].as<std::string>());
+        }
+		controller.flush();
+        run.trace = trace;
+        run.runtimeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        run.timing = result.count("timing") > 0;
+        run.peakRssBytes = peakRssBytes();
+        run.cacheBytes = controller.cacheMemoryFootprint();
 
 		// output
-		std::cout << controller.printResults();
+        if (recordToStdout) {
+            writeResults(std::cout, outputFormat, controller, run);
+        }
+        else {
+            std::cout << controller.printResults() << "\n";
+            if (result.count("shm-drop")) std::cout << std::format("  dropped accesses: {}\n", run.droppedAccesses);
+        }
+        if (run.timing) {
+            writeTimingReport(recordToStdout ? std::cerr : std::cout, controller, run);
+        }
+        if (result.count("reuse")) {
+            controller.writeReuseHistograms(result["reuse"].as<std::string>());
+        }
+        if (result.count("latency-histogram")) {
+            controller.writeLatencyHistogram(result["latency-histogram"].as<std::string>());
+        }
+        if (result.count("set-stats")) {
+            controller.writeSetStats(result["set-stats"].as<std::string>());
+        }
         if (output == "") {
             return 0;
         }
@@ -166,7 +466,7 @@ int main(int argc, char *argv[]) {
 			std::string error = std::format("Couldn't open file '{}'. Check if it exists and the path to the file is correct.", output);
 			throw std::runtime_error(error);
 		}
-        outputFile << controller.printResults();
+        writeResults(outputFile, outputFormat, controller, run);
         outputFile.close();
 
 
@@ -0,0 +1,62 @@
+/* CacheSimShmProducer: local test producer for CacheSim --shm
+* replays a trace in the default format ("# <op> <address> ...") into the ring,
+* or, without a trace, writes a strided stream (every fourth access a write)
+*
+*   CacheSim --shm /trace &
+*   CacheSimShmProducer /trace ./traces/art.trace
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cachesim_shm.h"
+
+int main(int argc, char* argv[]) {
+	cachesim_shm_producer producer;
+	unsigned long long accesses = 0;
+	struct timespec retry = { 0, 50000000 };
+	int attempt;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <name> [trace | -n accesses]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	/* CacheSim may still be starting */
+	for (attempt = 0; cachesim_shm_attach(&producer, argv[1]) != 0; attempt++) {
+		if (attempt == 100) {
+			fprintf(stderr, "error: no ring '%s', start CacheSim --shm %s first\n", argv[1], argv[1]);
+			return EXIT_FAILURE;
+		}
+		nanosleep(&retry, 0);
+	}
+
+	if (argc >= 4 && strcmp(argv[2], "-n") == 0) {
+		unsigned long long count = strtoull(argv[3], 0, 10);
+		for (; accesses < count; accesses++) {
+			cachesim_shm_push(&producer, (accesses * 64) % (1 << 24), accesses % 4 == 3 ? CACHESIM_SHM_WRITE : CACHESIM_SHM_READ);
+		}
+	}
+	else if (argc >= 3) {
+		char line[256];
+		FILE* trace = fopen(argv[2], "r");
+		if (!trace) {
+			fprintf(stderr, "error: couldn't open trace '%s'\n", argv[2]);
+			cachesim_shm_detach(&producer);
+			return EXIT_FAILURE;
+		}
+		while (fgets(line, sizeof(line), trace)) {
+			if (strlen(line) < 12 || (line[2] != '0' && line[2] != '1')) continue;
+			cachesim_shm_push(&producer, strtoull(line + 4, 0, 16), line[2] == '1' ? CACHESIM_SHM_WRITE : CACHESIM_SHM_READ);
+			accesses++;
+		}
+		fclose(trace);
+	}
+	else {
+		for (; accesses < 10000000; accesses++) {
+			cachesim_shm_push(&producer, (accesses * 64) % (1 << 24), accesses % 4 == 3 ? CACHESIM_SHM_WRITE : CACHESIM_SHM_READ);
+		}
+	}
+
+	fprintf(stderr, "%llu accesses written, %llu dropped\n", accesses, (unsigned long long)producer.dropped);
+	cachesim_shm_detach(&producer);
+	return 0;
+}